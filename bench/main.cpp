@@ -0,0 +1,351 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <cstdio>
+#include <sys/resource.h>
+
+#include <UnixSocket.h>
+
+/* Sweeps framings, server's I/O threads, client counts and message sizes.
+ * Each case is one row of the CSV file ( '--out', 'UnixSocketBench.csv' by default ) :
+ *  mode,framing,io_threads,clients,msg_size,messages,seconds,msg_per_sec,mb_per_sec,p50_us,p99_us,p999_us
+ * 'throughput' : all clients send to the server at once, server only counts frames.
+ * 'latency' : each client waits for the server's echo before the next send.
+ * Options : '--quick' - short sweep, '--budget=MB' - bytes sent per case, 
+ * '--verbose' - keep the library's log, below 'UNIX_SOCKET_LOG_DEBUG' it writes every frame. */
+
+using namespace UnixSocket;
+using Clock = ::std::chrono::steady_clock;
+
+#define BENCH_ADDRESS   "/tmp/UnixSocketBench"
+#define CASE_TIMEOUT    ::std::chrono::seconds( 60 )
+#define MAX_CASE_BYTES  ( 1ul << 30 ) /* One message of each client, bigger cases are skipped */
+#define MAX_PACKET_SIZE ( 64ul * 1024 ) /* Default socket buffer takes bigger packets badly */
+
+struct Case
+{
+    Framing         m_framing;
+    ::std::size_t   m_io_threads;
+    ::std::size_t   m_clients;
+    ::std::size_t   m_msg_size;
+};
+
+struct Row
+{
+    ::std::string   m_mode;
+    Case            m_case;
+    ::std::size_t   m_messages = 0;
+    double          m_seconds = 0;
+    double          m_p50_us = 0;
+    double          m_p99_us = 0;
+    double          m_p999_us = 0;
+};
+
+static const char * framingName( Framing framing )
+{
+    switch( framing )
+    {
+        case Framing::DELIMITER :       return "delimiter";
+        case Framing::LENGTH_PREFIX :   return "length_prefix";
+        case Framing::PACKET :          return "packet";
+        default :                       return "unknown";
+    }
+}
+
+/* Frame of exactly 'size' bytes on the wire, tags included */
+static Buffer makePayload( Framing framing, ::std::size_t size )
+{
+    if( framing != Framing::DELIMITER )
+    {
+        return Buffer( size, 'x' );
+    }
+    const ::std::string open_tag{ "<body>" };
+    const ::std::string close_tag{ "</body>" };
+    ::std::size_t tags = open_tag.size() + close_tag.size();
+    return open_tag + Buffer( size > tags ? size - tags : 0, 'x' ) + close_tag;
+}
+
+static Server::Config serverConfig( const Case& bench_case )
+{
+    Server::Config config = 
+    {
+        .m_recv_cb      = []( const ClientId&, ::std::string& ){},
+        .m_send_cb      = []( const ClientId&, ::std::size_t ){},
+        .m_error_cb     = []( const ClientId&, const ErrorDescription& ){},
+        .m_address      = BENCH_ADDRESS,
+        .m_delimiter    = "body",
+        .m_framing      = bench_case.m_framing,
+        .m_transport    = ( bench_case.m_framing == Framing::PACKET ) ? 
+            Transport::SEQPACKET : Transport::STREAM,
+        .m_max_packet   = ::std::max( bench_case.m_msg_size, MAX_PACKET_SIZE ),
+        .m_handshake    = Handshake::BINARY,
+        .m_io_threads   = bench_case.m_io_threads
+    };
+    return config;
+}
+
+static Client::Config clientConfig( const Case& bench_case, ::std::size_t idx,
+    ::std::function< RecvCallBack > recv_cb )
+{
+    Client::Config config =
+    {
+        .m_recv_cb      = ::std::move( recv_cb ),
+        .m_send_cb      = []( const ClientId&, ::std::size_t ){},
+        .m_address      = BENCH_ADDRESS,
+        .m_delimiter    = "body",
+        .m_client_id    = "bench" + ::std::to_string( idx ),
+        .m_con_type     = Client::ConnectType::SYNC_CONNECT,
+        .m_framing      = bench_case.m_framing,
+        .m_transport    = ( bench_case.m_framing == Framing::PACKET ) ? 
+            Transport::SEQPACKET : Transport::STREAM,
+        .m_max_packet   = ::std::max( bench_case.m_msg_size, MAX_PACKET_SIZE ),
+        .m_handshake    = Handshake::BINARY,
+        .m_reconnect    = false
+    };
+    return config;
+}
+
+/* Clients are split between sender threads, there may be more clients than cores */
+template< typename Work >
+static void runSenders( ::std::size_t clients, Work work )
+{
+    ::std::size_t senders = ::std::min< ::std::size_t >( clients, 
+        ::std::max( 1u, ::std::thread::hardware_concurrency() ) );
+    ::std::vector< ::std::thread > threads;
+    for( ::std::size_t sender = 0; sender < senders; sender++ )
+    {
+        threads.emplace_back( [ &, sender ]()
+        {
+            for( ::std::size_t idx = sender; idx < clients; idx += senders )
+            {
+                work( idx );
+            }
+        } );
+    }
+    for( auto& thread : threads )
+    {
+        thread.join();
+    }
+}
+
+static Row throughput( const Case& bench_case, ::std::size_t budget )
+{
+    Row row{ "throughput", bench_case };
+    ::std::size_t per_client = ::std::max< ::std::size_t >( 1, 
+        budget / ( bench_case.m_msg_size * bench_case.m_clients ) );
+    ::std::atomic< ::std::size_t > received{ 0 };
+
+    Server server;
+    Server::Config config = serverConfig( bench_case );
+    config.m_recv_view_cb = [ & ]( const ClientId&, const Frame& ){ received++; };
+    server.setConfig( ::std::move( config ) );
+    server.start();
+
+    ::std::vector< ::std::unique_ptr< Client > > clients;
+    for( ::std::size_t idx = 0; idx < bench_case.m_clients; idx++ )
+    {
+        clients.emplace_back( ::std::make_unique< Client >() );
+        clients.back()->setConfig( clientConfig( bench_case, idx, 
+            []( const ClientId&, ::std::string& ){} ) );
+        clients.back()->start();
+    }
+    /* One payload is shared by all sends, nothing is copied or allocated per message */
+    ConstBufferShPtr payload = makeShared( makePayload( bench_case.m_framing, bench_case.m_msg_size ) );
+    ::std::atomic< ::std::size_t > accepted{ 0 };
+
+    Clock::time_point start = Clock::now();
+    runSenders( bench_case.m_clients, [ & ]( ::std::size_t idx )
+    {
+        for( ::std::size_t msg = 0; msg < per_client; msg++ )
+        {
+            if( clients[ idx ]->send( payload ) == Result::SEND_SUCCESS )
+            {
+                accepted++;
+            }
+        }
+    } );
+    while( received.load() < accepted.load() && Clock::now() - start < CASE_TIMEOUT )
+    {
+        ::std::this_thread::sleep_for( ::std::chrono::microseconds( 100 ) );
+    }
+    row.m_seconds = ::std::chrono::duration< double >( Clock::now() - start ).count();
+    row.m_messages = received.load();
+    return row;
+}
+
+/* Reply of the server wakes up the client's sender */
+struct Probe
+{
+    ::std::mutex m_mtx;
+    ::std::condition_variable m_cv;
+    bool m_is_replied = false;
+};
+
+static Row latency( const Case& bench_case, ::std::size_t budget )
+{
+    Row row{ "latency", bench_case };
+    ::std::size_t rounds = ::std::min< ::std::size_t >( 10000, ::std::max< ::std::size_t >( 10,
+        budget / ( 2 * bench_case.m_msg_size * bench_case.m_clients ) ) );
+
+    Server server;
+    Server::Config config = serverConfig( bench_case );
+    config.m_recv_cb = [ & ]( const ClientId& client_id, ::std::string& data )
+    {
+        server.send( client_id, data );
+    };
+    server.setConfig( ::std::move( config ) );
+    server.start();
+
+    ::std::vector< ::std::unique_ptr< Probe > > probes;
+    ::std::vector< ::std::unique_ptr< Client > > clients;
+    for( ::std::size_t idx = 0; idx < bench_case.m_clients; idx++ )
+    {
+        probes.emplace_back( ::std::make_unique< Probe >() );
+        Probe * probe = probes.back().get();
+        clients.emplace_back( ::std::make_unique< Client >() );
+        clients.back()->setConfig( clientConfig( bench_case, idx,
+            [ probe ]( const ClientId&, ::std::string& )
+            {
+                ::std::lock_guard< ::std::mutex > lock( probe->m_mtx );
+                probe->m_is_replied = true;
+                probe->m_cv.notify_one();
+            } ) );
+        clients.back()->start();
+    }
+    ConstBufferShPtr payload = makeShared( makePayload( bench_case.m_framing, bench_case.m_msg_size ) );
+    ::std::mutex samples_mtx;
+    ::std::vector< double > samples; //microseconds
+    samples.reserve( rounds * bench_case.m_clients );
+
+    Clock::time_point start = Clock::now();
+    runSenders( bench_case.m_clients, [ & ]( ::std::size_t idx )
+    {
+        Probe& probe = * probes[ idx ];
+        ::std::vector< double > own;
+        own.reserve( rounds );
+        for( ::std::size_t round = 0; round < rounds; round++ )
+        {
+            Clock::time_point sent = Clock::now();
+            if( clients[ idx ]->send( payload ) != Result::SEND_SUCCESS )
+            {
+                break;
+            }
+            ::std::unique_lock< ::std::mutex > lock( probe.m_mtx );
+            if( ! probe.m_cv.wait_for( lock, CASE_TIMEOUT, [ & ](){ return probe.m_is_replied; } ) )
+            {
+                break;
+            }
+            probe.m_is_replied = false;
+            own.push_back( ::std::chrono::duration< double, ::std::micro >( 
+                Clock::now() - sent ).count() );
+        }
+        ::std::lock_guard< ::std::mutex > lock( samples_mtx );
+        samples.insert( samples.end(), own.begin(), own.end() );
+    } );
+    row.m_seconds = ::std::chrono::duration< double >( Clock::now() - start ).count();
+    row.m_messages = samples.size();
+    if( ! samples.empty() )
+    {
+        ::std::sort( samples.begin(), samples.end() );
+        auto percentile = [ & ]( double share )
+        {
+            return samples[ ::std::min( samples.size() - 1, 
+                static_cast< ::std::size_t >( share * samples.size() ) ) ];
+        };
+        row.m_p50_us = percentile( 0.50 );
+        row.m_p99_us = percentile( 0.99 );
+        row.m_p999_us = percentile( 0.999 );
+    }
+    return row;
+}
+
+static void write( ::std::ostream& out, const Row& row )
+{
+    double msg_per_sec = row.m_seconds > 0 ? row.m_messages / row.m_seconds : 0;
+    /* Echo doubles the bytes on the wire */
+    double mb_per_sec = msg_per_sec * row.m_case.m_msg_size * ( row.m_mode == "latency" ? 2 : 1 ) 
+        / ( 1024.0 * 1024.0 );
+    out << row.m_mode << ',' << framingName( row.m_case.m_framing ) << ','
+        << row.m_case.m_io_threads << ',' << row.m_case.m_clients << ','
+        << row.m_case.m_msg_size << ',' << row.m_messages << ','
+        << row.m_seconds << ',' << msg_per_sec << ',' << mb_per_sec << ','
+        << row.m_p50_us << ',' << row.m_p99_us << ',' << row.m_p999_us << ::std::endl;
+}
+
+int main( int argc, char ** argv )
+{
+    bool is_quick = false;
+    bool is_verbose = false;
+    ::std::size_t budget = 64ul << 20;
+    ::std::string out_path{ "UnixSocketBench.csv" };
+    for( int idx = 1; idx < argc; idx++ )
+    {
+        ::std::string arg{ argv[ idx ] };
+        if( arg == "--quick" )
+            is_quick = true;
+        else if( arg == "--verbose" )
+            is_verbose = true;
+        else if( arg.rfind( "--budget=", 0 ) == 0 )
+            budget = ::std::stoul( arg.substr( 9 ) ) << 20;
+        else if( arg.rfind( "--out=", 0 ) == 0 )
+            out_path = arg.substr( 6 );
+        else
+        {
+            ::std::cerr << "Usage : " << argv[ 0 ] 
+                        << " [--quick] [--budget=MB] [--out=file.csv] [--verbose]" << ::std::endl;
+            return 1;
+        }
+    }
+    if( ! is_verbose && ! ::std::freopen( "/dev/null", "w", stdout ) )
+    {
+        ::std::cerr << "Can't mute the log." << ::std::endl;
+    }
+    /* Client and server sides of 1000 connections don't fit the usual 1024 descriptors */
+    rlimit limit{};
+    if( ::getrlimit( RLIMIT_NOFILE, & limit ) == 0 )
+    {
+        limit.rlim_cur = limit.rlim_max;
+        ::setrlimit( RLIMIT_NOFILE, & limit );
+    }
+
+    ::std::vector< Framing > framings{ Framing::DELIMITER, Framing::LENGTH_PREFIX, Framing::PACKET };
+    ::std::vector< ::std::size_t > io_threads{ 1, 2, 4, 0 }; //'0' - one per core
+    ::std::vector< ::std::size_t > clients{ 1, 10, 100, 1000 };
+    ::std::vector< ::std::size_t > sizes{ 16, 256, 4096, 64ul << 10, 1ul << 20, 16ul << 20 };
+    if( is_quick )
+    {
+        io_threads = { 1, 2 };
+        clients = { 1, 10 };
+        sizes = { 16, 4096, 1ul << 20 };
+    }
+
+    ::std::ofstream out( out_path );
+    out << "mode,framing,io_threads,clients,msg_size,messages,seconds,"
+           "msg_per_sec,mb_per_sec,p50_us,p99_us,p999_us" << ::std::endl;
+    for( Framing framing : framings )
+    for( ::std::size_t threads : io_threads )
+    for( ::std::size_t client_num : clients )
+    for( ::std::size_t size : sizes )
+    {
+        if( ( framing == Framing::PACKET && size > MAX_PACKET_SIZE ) || 
+            size * client_num > MAX_CASE_BYTES )
+        {
+            continue;
+        }
+        Case bench_case{ framing, threads, client_num, size };
+        for( const Row& row : { throughput( bench_case, budget ), latency( bench_case, budget ) } )
+        {
+            write( out, row );
+            write( ::std::cerr, row );
+        }
+    }
+    ::std::cerr << "Results are written to " << out_path << ::std::endl;
+    return 0;
+}
\ No newline at end of file
@@ -5,11 +5,23 @@
 #include <vector>
 #include <list>
 #include <string>
+#include <string_view>
+#include <cstring>
 #include <memory>
 #include <atomic>
 #include <sstream>
 #include <unordered_map>
 #include <mutex>
+#include <condition_variable>
+#include <array>
+#include <cstdint>
+#include <thread>
+#include <future>
+#include <deque>
+#include <shared_mutex>
+#include <chrono>
+#include <random>
+#include <utility> /* Coroutine support of asio uses 'std::exchange' without it */
 
 #include <boost/asio.hpp>
 #include <boost/property_tree/ptree.hpp>
@@ -27,29 +39,89 @@ namespace UnixSocket
     class Server;
     class Client;
     enum class Result;
+    struct Frame;
+    class Fd;
 
+    enum class Transport //: uint8_t
+    {
+        STREAM      = 0, /* SOCK_STREAM */
+        SEQPACKET   = 1  /* SOCK_SEQPACKET : kernel keeps message boundaries */
+    };
+
+    /* Local protocol with the socket type chosen at run time.
+     * Stream and seqpacket sockets share the same 'Server', 'Session' and 'Client'. */
+    class Protocol
+    {
+    public :
+        using endpoint  = ::boost::asio::local::basic_endpoint< Protocol >;
+        using socket    = ::boost::asio::basic_stream_socket< Protocol >;
+        using acceptor  = ::boost::asio::basic_socket_acceptor< Protocol >;
+
+        Protocol() = default; /* SOCK_STREAM */
+        explicit Protocol( Transport transport )
+            : m_type( transport == Transport::SEQPACKET ? SOCK_SEQPACKET : SOCK_STREAM )
+        { }
+        int type() const
+        {
+            return m_type;
+        }
+        int protocol() const
+        {
+            return 0;
+        }
+        int family() const
+        {
+            return AF_UNIX;
+        }
+    private :
+        int m_type{ SOCK_STREAM };
+    }; //end class Protocol
 
     using IoService     = ::boost::asio::io_service;
+    using IoServiceUptr = ::std::unique_ptr< IoService >;
+    using WorkGuard     = ::boost::asio::executor_work_guard< IoService::executor_type >;
     using ErrCode       = ::boost::system::error_code;
 
-    using EndPoint      = ::boost::asio::local::stream_protocol::endpoint;
+    using EndPoint      = Protocol::endpoint;
     using EndPointUptr  = ::std::unique_ptr< EndPoint >;
-    using Acceptor      = ::boost::asio::local::stream_protocol::acceptor;
+    using Acceptor      = Protocol::acceptor;
     using AcceptorUptr  = ::std::unique_ptr< Acceptor >;
 
-    using Socket        = ::boost::asio::local::stream_protocol::socket;
+    using Socket        = Protocol::socket;
     using SocketUptr    = ::std::unique_ptr< Socket >;
 
     using ClientId      = ::std::string;
     using Tree          = ::boost::property_tree::ptree;
 
     using RecvCallBack  = void( const ClientId&, ::std::string& );
+    using Batch         = ::std::vector< ::std::string >;
+    using RecvBatchCallBack = void( const ClientId&, Batch& ); /* All frames from one read */
+    using RecvViewCallBack = void( const ClientId&, const Frame& ); /* No copy of the data */
+    using Fds           = ::std::vector< Fd >;
+    using RecvFdsCallBack = void( const ClientId&, ::std::string&, Fds& ); /* Take 'Fd's you need */
     using SendCallBack  = void( const ClientId&, ::std::size_t );
     using ErrorDescription = ::std::string;
     using ErrorCallBack = void( const ClientId&, const ErrorDescription& );
+    struct PeerCred;
+    using PeerCheckCallBack = bool( const ClientId&, const PeerCred& ); /* 'false' - reject */
+
+    /* Number given to the client at identification : slot in the low half, 
+     * its generation in the high half. Cheaper to hash and compare than the name. */
+    using ClientHandle  = ::std::uint64_t;
+    constexpr ClientHandle INVALID_HANDLE = 0;
+    using RecvHandleCallBack = void( ClientHandle, ::std::string& );
+    using SendHandleCallBack = void( ClientHandle, ::std::size_t );
+    using ErrorHandleCallBack = void( ClientHandle, const ErrorDescription& );
+    using IdentifiedCallBack = void( ClientHandle, const ClientId& ); /* Once per client */
+    using WatermarkCallBack = void( const ClientId&, bool is_high ); /* Outbound queue of the client */
+    using OrderKey      = ::std::size_t; /* Frames with the same key go through the same connection */
+
+    using StatsClock    = ::std::chrono::steady_clock; /* Timestamps of the metrics */
 
     using Buffer        = ::std::string;
     using BufferShPtr   = ::std::shared_ptr< Buffer >;
+    using ConstBufferShPtr = ::std::shared_ptr< const Buffer >;
+    using Chunks        = ::std::vector< ConstBufferShPtr >; /* Pieces of one message, look 'sendChunks' */
 }
 
 namespace UnixSocket
@@ -57,6 +129,8 @@ namespace UnixSocket
 
     enum class Result //: int8_t
     {
+        TIMED_OUT       = -7, /* No reply in time, look 'RpcClient' */
+        WOULD_BLOCK     = -6, /* Outbound queue is full, data isn't sent */
         SEND_ERROR      = -5,
         RECV_ERROR      = -4,
         ID_FAILURE      = -3,
@@ -67,15 +141,728 @@ namespace UnixSocket
         ID_SUCCESS      = 2,
     }; //end class Result
 
+    /* Records are formatted by the caller and written to the terminal by the background
+     * thread, so I/O threads never wait for the terminal. Queue is bounded and lock free :
+     * when it's full the record is dropped and counted. Used through '*_LOG' macros,
+     * levels below 'UNIX_SOCKET_LOG_LEVEL' compile to nothing. */
+    class Logger
+    {
+    public : /*--- Methods ---*/
+        static Logger& instance(); /* Never destroyed, flushed at exit */
+        void log( int level, const char * color, const char * func, int line,
+            const char * format, ... ) __attribute__(( format( printf, 6, 7 ) ));
+        void flush(); /* Returns when everything logged before is written */
+        ::std::uint64_t dropped() const
+        {
+            return m_dropped.load( ::std::memory_order_relaxed );
+        }
+
+    private :
+        Logger();
+        void drain(); /* Background thread */
+        bool pop(); /* Writes one record, 'false' if there is none */
+
+    private :
+        static constexpr ::std::size_t CAPACITY = 1024; //records, power of two
+        static constexpr ::std::size_t RECORD_SIZE = 256; //longer text is cut
+        struct Record
+        {
+            ::std::atomic< ::std::uint64_t > m_seq; //position the record is ready for
+            int m_level;
+            char m_text[ RECORD_SIZE ];
+        };
+
+    private : /*--- Variables ---*/
+        ::std::unique_ptr< Record[] > m_records;
+        alignas( 64 ) ::std::atomic< ::std::uint64_t > m_head{ 0 }; //claimed by producers
+        alignas( 64 ) ::std::atomic< ::std::uint64_t > m_tail{ 0 }; //moved by the drain thread
+        ::std::atomic< ::std::uint64_t > m_dropped{ 0 };
+        /* After exit handlers records are written by the caller, thread may be gone */
+        ::std::atomic< bool > m_is_sync{ false };
+    }; //end class Logger
+
+    enum class Framing //: uint8_t
+    {
+        DELIMITER       = 0, /* <'m_delimiter'>...</'m_delimiter'> */
+        LENGTH_PREFIX   = 1, /* 'FrameHeader' followed by exactly 'm_length' bytes of body */
+        PACKET          = 2  /* 'Transport::SEQPACKET' only : each packet is the message */
+    };
+
+    enum class FrameType : ::std::uint16_t
+    {
+        DATA            = 0,
+        IDENTIFICATION  = 1,
+        /* Shared memory negotiation, look 'ShmChannel' */
+        SHM_OFFER       = 2, /* client -> server : 'memfd' and 'eventfd's are attached */
+        SHM_ACCEPT      = 3, /* server -> client : server's data goes through the ring after it */
+        SHM_REJECT      = 4, /* server -> client */
+        SHM_START       = 5  /* client -> server : client's data goes through the ring after it */
+    };
+
+    enum FrameFlags : ::std::uint16_t
+    {
+        FLAG_FDS        = 0x0001, /* Descriptors are attached, their number is in the high byte */
+        FLAG_CHUNK      = 0x0002, /* Piece of the split message, look 'm_chunk_size'. Lane is in the high byte */
+        FLAG_MORE       = 0x0004  /* Not the last piece */
+    };
+
+    /* Precedes each message in 'Framing::LENGTH_PREFIX' mode.
+     * Both sides live at the same host, so native byte order is used. */
+    struct FrameHeader
+    {
+        ::std::uint32_t m_length; //size of the body, header excluded
+        ::std::uint16_t m_type;
+        ::std::uint16_t m_flags;
+    };
+    static_assert( sizeof( FrameHeader ) == 8, "FrameHeader should be packed" );
+
+    enum class Handshake //: uint8_t
+    {
+        XML     = 0, /* <'m_id_key'>ClientName</'m_id_key'>, compatibility mode */
+        BINARY  = 1  /* 'FrameType::IDENTIFICATION' frame, whatever the framing is */
+    };
+
+    enum HandshakeCaps : ::std::uint16_t
+    {
+        CAP_FDS         = 0x0001, /* 'm_pass_fds' is set */
+        CAP_SHM         = 0x0002, /* Shared memory will be offered */
+        CAP_GROUP       = 0x0004, /* Connection is the member of the client group, look 'ClientPool' */
+        CAP_CHUNKS      = 0x0008  /* Split messages are reassembled, look 'm_chunk_size' */
+    };
+
+    /* Body of the binary handshake, followed by the bytes of the client's ID.
+     * ID length is 'FrameHeader::m_length' minus the size of this structure. */
+    struct HandshakeHeader
+    {
+        ::std::uint16_t m_version;
+        ::std::uint16_t m_caps;
+    };
+    static_assert( sizeof( HandshakeHeader ) == 4, "HandshakeHeader should be packed" );
+    constexpr ::std::uint16_t HANDSHAKE_VERSION = 1;
+    constexpr ::std::size_t MAX_ID_LENGTH = 1024;
+
+    /* Credentials of the connected process, taken by the kernel at 'connect' */
+    struct PeerCred
+    {
+        pid_t m_pid;
+        uid_t m_uid;
+        gid_t m_gid;
+    };
+
+    inline FrameHeader makeHeader( ::std::size_t length, FrameType type = FrameType::DATA )
+    {
+        return FrameHeader{ static_cast< ::std::uint32_t >( length ),
+            static_cast< ::std::uint16_t >( type ), 0 };
+    }
+
+    inline ::std::size_t fdsNumber( const FrameHeader& header )
+    {
+        return ( header.m_flags & FLAG_FDS ) ? ( header.m_flags >> 8 ) : 0;
+    }
+
+    /* Lanes of the 'OutQueue'. Higher one is written first, frames of one lane keep their order. */
+    enum class Priority //: uint8_t
+    {
+        HIGH            = 0, /* Control plane, heartbeats */
+        NORMAL          = 1,
+        BULK            = 2  /* Large transfers */
+    };
+    constexpr ::std::size_t PRIORITY_LANES = 3;
+
+    inline ::std::size_t chunkLane( const FrameHeader& header )
+    {
+        return ( header.m_flags & FLAG_CHUNK ) ? ( header.m_flags >> 8 ) : 0;
+    }
+
+    /* Owner of the file descriptor, closes it on destruction */
+    class Fd
+    {
+    public : /*--- Methods ---*/
+        Fd() = default;
+        explicit Fd( int fd )
+            : m_fd( fd )
+        { }
+        Fd( Fd&& other ) noexcept
+            : m_fd( other.release() )
+        { }
+        Fd& operator=( Fd&& other ) noexcept
+        {
+            reset( other.release() );
+            return * this;
+        }
+        Fd( const Fd& ) = delete;
+        Fd& operator=( const Fd& ) = delete;
+        ~Fd()
+        {
+            reset();
+        }
+        int get() const
+        {
+            return m_fd;
+        }
+        int release() /* Caller is responsible to close it */
+        {
+            int fd = m_fd;
+            m_fd = -1;
+            return fd;
+        }
+        void reset( int fd = -1 );
+    private : /*--- Variables ---*/
+        int m_fd{ -1 };
+    }; //end class Fd
+
+    /* Ancillary data (SCM_RIGHTS) helpers. Both are non-blocking,
+     * 'error' is set to 'would_block' if socket isn't ready. */
+    ::std::size_t sendWithFds( Socket&, const ::boost::asio::const_buffer *, ::std::size_t buf_num,
+        const Fds&, ErrCode& error );
+    ::std::size_t recvWithFds( Socket&, ::boost::asio::mutable_buffer, 
+        ::std::deque< Fd >&, ErrCode& error );
+    Result dupFds( const ::std::vector< int >&, Fds& ); /* Caller keeps its descriptors */
+
+    /* Part of the input buffer, kept alive after the receive callback is returned. */
+    class Retained /* Default constructable */
+    {
+    public : /*--- Methods ---*/
+        Retained() = default;
+        Retained( ConstBufferShPtr owner, ::std::string_view view )
+            : m_owner( ::std::move( owner ) ),
+            m_view( view )
+        { }
+        ::std::string_view view() const
+        {
+            return m_view;
+        }
+        const char * data() const
+        {
+            return m_view.data();
+        }
+        ::std::size_t size() const
+        {
+            return m_view.size();
+        }
+    private : /*--- Variables ---*/
+        ConstBufferShPtr m_owner; //slab of 'InBuffer'
+        ::std::string_view m_view;
+    }; //end class Retained
+
+    /* One complete message cut out of the input stream.
+     * Points into 'InBuffer' and is valid until the receive callback is returned,
+     * use 'retain' to keep it longer without copy. */
+    struct Frame
+    {
+        FrameHeader         m_header; //made up for 'Framing::DELIMITER'
+        const char *        m_data;
+        ::std::size_t       m_size;
+        const BufferShPtr * m_slab; //owner of the data, 'nullptr' for the shared memory
+
+        ::std::string_view view() const
+        {
+            return ::std::string_view( m_data, m_size );
+        }
+        Retained retain() const
+        {
+            if( ! m_slab ) /* Ring space is reused by the peer, so copy is the only option */
+            {
+                ConstBufferShPtr copy = ::std::make_shared< const Buffer >( m_data, m_size );
+                ::std::string_view copy_view( copy->data(), copy->size() );
+                return Retained( ::std::move( copy ), copy_view );
+            }
+            return Retained( * m_slab, view() );
+        }
+    };
+
+    /* Persistent input buffer. Bytes read after the end of the last complete frame
+     * stay in place, so nothing is lost between reads and one read can bring many frames.
+     * Data lives in the refcounted slab : while any frame of it is retained,
+     * slab isn't reused and the unconsumed tail moves to the new one. */
+    class InBuffer /* Default constructable */
+    {
+    public : /*--- Methods ---*/
+        InBuffer()
+            : m_slab( ::std::make_shared< Buffer >() )
+        { }
+        /* Free space for the next read, not less than 'min_space' */
+        ::boost::asio::mutable_buffer prepare( ::std::size_t min_space );
+        void commit( ::std::size_t bytes_transferred );
+        /* Cut next complete frame out of the buffered data.
+         * Returns 'false' when more data should be read. Search of 'end_tag' goes on
+         * from where the previous one stopped, so the tag shouldn't change meanwhile. */
+        bool next( Framing, const ::std::string& end_tag, Frame& );
+            /* Pieces of the split message are glued back, only the whole one comes out */
+        ::std::size_t size() const
+        {
+            return m_end - m_begin;
+        }
+        void clear() /* Data of the broken connection is dropped */
+        {
+            m_begin = m_end = m_missing = m_scan = 0;
+            m_assembly = {};
+            m_assembled = PRIORITY_LANES;
+        }
+
+    private : /*--- Methods ---*/
+        bool cut( Framing, const ::std::string& end_tag, Frame& ); /* Next frame on the wire */
+        bool assemble( Frame& ); /* 'FLAG_CHUNK' one, 'true' - message is complete */
+
+    private : /*--- Variables ---*/
+        BufferShPtr m_slab;
+        ::std::size_t m_begin = 0;      //first byte of unconsumed data
+        ::std::size_t m_end = 0;        //end of received data
+        ::std::size_t m_missing = 0;    //bytes lacking for the current frame, if known
+        ::std::size_t m_scan = 0;       //'Framing::DELIMITER' : end tag doesn't start before it
+        /* Pieces of the split messages, look 'FLAG_CHUNK'. Lanes are interleaved on the wire. */
+        ::std::array< BufferShPtr, PRIORITY_LANES > m_assembly;
+        ::std::size_t m_assembled = PRIORITY_LANES; //lane, whose message is given out as the frame
+    }; //end class InBuffer
+
+    /* Message waiting in the 'OutQueue' */
+    struct OutFrame
+    {
+        FrameHeader         m_header; //not sent for 'Framing::DELIMITER'
+        ConstBufferShPtr    m_payload;
+        Fds                 m_fds; //sent with 'sendmsg' as ancillary data
+        StatsClock::time_point m_queued_at{}; //set by 'OutQueue::push' for the send latency
+        Chunks              m_chunks; //written right after 'm_payload' as the same frame
+        Priority            m_priority = Priority::NORMAL;
+        ::std::size_t       m_offset = 0; //body bytes already written as pieces, look 'FLAG_CHUNK'
+        ::std::uint64_t     m_seq = 0; //push order, set by 'OutQueue::push'
+
+        ::std::size_t size() const /* Body without the header */
+        {
+            ::std::size_t size = m_payload->size();
+            for( const ConstBufferShPtr& chunk : m_chunks )
+            {
+                size += chunk->size();
+            }
+            return size;
+        }
+    };
+    using OutFrames = ::std::vector< OutFrame >;
+
+    /* One frame of the chunks, none of them is copied */
+    OutFrame makeFrame( Chunks&& );
+
+    /* Identification frame of the client. Binary one carries its header in the payload 
+     * for framings, that write no headers : server reads it as length prefixed. */
+    OutFrame makeIdentification( Handshake, Framing, const ::std::string& id_key, 
+        const ClientId&, ::std::uint16_t caps );
+    /* Empty name if the frame isn't a valid identification. XML one has only 'CAP_GROUP'. */
+    ClientId parseIdentification( const Frame&, Handshake, const ::std::string& id_key,
+        ::std::uint16_t& caps );
+
+    enum class Overflow //: uint8_t
+    {
+        DROP_OLDEST     = 0, /* Queued data frames, that aren't written yet, make room */
+        DROP_NEWEST     = 1, /* Frame being sent is dropped, 'Result::WOULD_BLOCK' */
+        DISCONNECT      = 2, /* Slow consumer is dropped, 'Result::SEND_ERROR' */
+        BLOCK           = 3  /* Caller waits for the low watermark up to 'm_block_timeout' */
+    };
+
+    /* Limits of the data queued for one peer. Reaching any of the high ones
+     * applies 'm_overflow', queue is relieved when it is below both low ones. */
+    struct Watermarks
+    {
+        ::std::size_t m_high_bytes = 0; //'0' - no limit
+        ::std::size_t m_low_bytes = 0;
+        ::std::size_t m_high_frames = 0; //'0' - no limit
+        ::std::size_t m_low_frames = 0;
+        Overflow m_overflow = Overflow::DROP_NEWEST;
+        ::std::chrono::milliseconds m_block_timeout{ 100 };
+    };
+
+    /* Durations in power of two buckets of microseconds : bucket 'i' counts [ 2^(i-1), 2^i ),
+     * the first one - below 1 us. Relaxed atomics only, 'add' is never locked. */
+    class Histogram /* Default constructable */
+    {
+    public :
+        static constexpr ::std::size_t BUCKETS = 32; //the last one takes everything longer
+
+        struct Snapshot
+        {
+            ::std::array< ::std::uint64_t, BUCKETS > m_buckets{};
+            ::std::uint64_t m_count = 0;
+            ::std::uint64_t m_sum_us = 0;
+            ::std::uint64_t m_max_us = 0;
+            ::std::uint64_t percentile( double share ) const; /* Upper bound of the bucket, us */
+        };
+
+    public : /*--- Methods ---*/
+        void add( StatsClock::duration );
+        Snapshot snapshot() const;
+
+    private : /*--- Variables ---*/
+        ::std::array< ::std::atomic< ::std::uint64_t >, BUCKETS > m_buckets{};
+        ::std::atomic< ::std::uint64_t > m_count{ 0 };
+        ::std::atomic< ::std::uint64_t > m_sum_us{ 0 };
+        ::std::atomic< ::std::uint64_t > m_max_us{ 0 };
+    }; //end class Histogram
+
+    /* Snapshot of one connection, look 'Server::stats' and 'Client::stats' */
+    struct ConnectionStats
+    {
+        ClientId        m_client_id; //empty until identification
+        ::std::uint64_t m_bytes_in = 0; //payloads of received frames
+        ::std::uint64_t m_frames_in = 0;
+        ::std::uint64_t m_bytes_out = 0; //written, as reported to 'm_send_cb'
+        ::std::uint64_t m_frames_out = 0;
+        ::std::size_t   m_queued_bytes = 0; //outbound queue at the moment of the snapshot
+        ::std::size_t   m_queued_frames = 0;
+        ::std::uint64_t m_read_errors = 0;
+        ::std::uint64_t m_write_errors = 0;
+        ::std::uint64_t m_overflows = 0; //frames refused or dropped by 'Watermarks'
+        ::std::chrono::microseconds m_identification{ 0 }; //since accept ( connect ), '0' - not yet
+        Histogram::Snapshot m_send_latency; //from 'send' to the end of its write, socket only
+    };
+
+    /* Always on counters of one connection. Relaxed : nothing is ordered by them. */
+    struct Metrics
+    {
+        ::std::atomic< ::std::uint64_t > m_bytes_in{ 0 };
+        ::std::atomic< ::std::uint64_t > m_frames_in{ 0 };
+        ::std::atomic< ::std::uint64_t > m_bytes_out{ 0 };
+        ::std::atomic< ::std::uint64_t > m_frames_out{ 0 };
+        ::std::atomic< ::std::uint64_t > m_read_errors{ 0 };
+        ::std::atomic< ::std::uint64_t > m_write_errors{ 0 };
+        ::std::atomic< ::std::uint64_t > m_overflows{ 0 };
+        ::std::atomic< ::std::uint64_t > m_identification_us{ 0 };
+        Histogram m_send_latency;
+
+        static void add( ::std::atomic< ::std::uint64_t >& counter, ::std::uint64_t value = 1 )
+        {
+            counter.fetch_add( value, ::std::memory_order_relaxed );
+        }
+        void fill( ConnectionStats& ) const; /* All but the name and the queue */
+    };
+
+    /* Take ownership of the payload. Result is immutable and may be passed to
+     * any number of 'send' calls, all of them will share the same memory. */
+    template< typename Data >
+    ConstBufferShPtr makeShared( Data&& );
+    /* Each piece is taken as 'makeShared' does : shared and temporary ones aren't copied.
+     * Envelope and payload are sent as one message without concatenation :
+     *  server.sendChunks( name, makeChunks( "<body>", payload_sh_ptr, "</body>" ) ); */
+    template< typename... Data >
+    Chunks makeChunks( Data&&... );
+
+    /* Outbound queue of the session or the client. Owns payloads and keeps at most one write 
+     * in flight. Everything queued behind it goes out with one gathered write, lanes of higher
+     * 'Priority' first. With the chunk size batch is bounded by it : big frame is written in
+     * pieces and frames of higher lanes, pushed meanwhile, are written between them, 
+     * pieces of their own big frames too.
+     * Service frames ( not 'FrameType::DATA' ) are never overtaken : frames pushed before one
+     * go ahead of it in any lane, frames pushed after it wait until it's written. */
+    class OutQueue /* Default constructable */
+    {
+    public :
+        using SentHandler   = ::std::function< void( ::std::size_t ) >; //called for each frame
+        using ErrorHandler  = ::std::function< void( const ErrCode& ) >;
+        using WatermarkHandler = ::std::function< void( bool is_high ) >; //high one is reached or queue is relieved
+        using Lane = ::std::deque< OutFrame >;
+
+    public : /*--- Methods ---*/
+        /* Pending handlers keep 'owner' alive, so the queue may outlive its removal */
+        void start( Socket&, Transport, Framing, SentHandler, ErrorHandler,
+            ::std::weak_ptr< void > owner = {} );
+        void limit( const Watermarks&, WatermarkHandler ); /* Before the first 'push' */
+        void split( ::std::size_t chunk_size ); /* Look 'm_chunk_size', peer should reassemble */
+        void measure( Metrics& ); /* Before the first 'push' : send latency and overflows */
+        void depth( ::std::size_t& bytes, ::std::size_t& frames ); /* Queued at the moment */
+        /* Thread safe. Service frames aren't limited. */
+        Result push( OutFrame&& );
+
+    private :
+        void write(); /* Executed by the socket's 'io_service' only */
+        void writePackets(); /* 'Transport::SEQPACKET' : each frame is the packet */
+        void writeFds(); /* Frame with descriptors goes alone */
+        void writeTail( ::std::size_t bytes_sent ); /* What 'sendmsg' didn't take */
+        void gather( const OutFrame&, bool with_header ); /* Pieces go to 'm_buffers' */
+        void take(); /* Next batch from the lanes to 'm_writing', 'm_mtx' is locked */
+        Lane * next(); /* Lane of the next frame or 'nullptr', 'm_mtx' is locked */
+        bool isSplittable( const OutFrame& ) const; //'m_mtx' is locked
+        void sent( ::std::size_t frames );
+        void fail( const ErrCode& );
+        void disconnect(); /* 'Overflow::DISCONNECT' */
+        ::std::size_t frameSize( const OutFrame& ) const; //bytes on the wire
+        bool isFull( ::std::size_t size ) const; //'m_mtx' is locked
+        bool isRelieved() const; //'m_mtx' is locked
+        void dropOldest( ::std::size_t size ); //'m_mtx' is locked
+        Result overflow( ::std::unique_lock< ::std::mutex >&, ::std::size_t size, bool& is_high );
+
+    private : /*--- Variables ---*/
+        Socket * m_socket_ptr{ nullptr };
+        Transport m_transport{ Transport::STREAM };
+        Framing m_framing{ Framing::DELIMITER };
+        SentHandler m_sent_handler;
+        ErrorHandler m_error_handler;
+        ::std::weak_ptr< void > m_owner;
+
+        ::std::mutex m_mtx; //protects 'm_lanes' and flags
+        ::std::array< Lane, PRIORITY_LANES > m_lanes; //by 'Priority'
+        Lane m_service; //service frames, each one is the barrier for the lanes
+        ::std::uint64_t m_pushed{ 0 }; //numbers the frames, look 'OutFrame::m_seq'
+        ::std::size_t m_chunk_size{ 0 };
+        OutFrames m_writing; //frames of the write in flight
+        ::std::size_t m_written{ 0 }; //frames of 'm_writing' already sent
+        ::std::vector< ::boost::asio::const_buffer > m_buffers; //gathered write
+        ::std::vector< iovec > m_iov; //'Transport::SEQPACKET' : pieces of the packets
+
+        Watermarks m_watermarks;
+        WatermarkHandler m_watermark_handler;
+        Metrics * m_metrics_ptr{ nullptr };
+        ::std::size_t m_queued_bytes{ 0 }; //pending and not yet written ones
+        ::std::size_t m_queued_frames{ 0 };
+        ::std::condition_variable m_relieved_cv; //'Overflow::BLOCK'
+
+        /*--- Flags ---*/
+        bool m_is_writing{ false };
+        bool m_is_broken{ false };
+        bool m_is_high{ false }; //high watermark was reached, low one isn't yet
+    }; //end class OutQueue
+
+    /* Single producer - single consumer ring of frames in the shared memory.
+     * Record is 'FrameHeader' followed by the body, aligned to 8 bytes.
+     * Records never wrap : if the tail of the ring is too short, it's skipped. */
+    class ShmRing /* Default constructable */
+    {
+    public :
+        struct Control
+        {
+            alignas( 64 ) ::std::atomic< ::std::uint64_t > m_head; //written by producer only
+            alignas( 64 ) ::std::atomic< ::std::uint64_t > m_tail; //written by consumer only
+            alignas( 64 ) ::std::atomic< ::std::uint32_t > m_consumer_sleeps; //wake it up with 'eventfd'
+            ::std::atomic< ::std::uint32_t > m_producer_waits; //for space
+        };
+        static_assert( ::std::atomic< ::std::uint64_t >::is_always_lock_free,
+            "Atomics in the shared memory should be lock free" );
+
+    public : /*--- Methods ---*/
+        static ::std::size_t footprint( ::std::size_t capacity )
+        {
+            return sizeof( Control ) + capacity;
+        }
+        void attach( char * memory, ::std::size_t capacity, bool init );
+        /* Producer */
+        bool push( const OutFrame& ); /* Chunks are gathered into the record */
+        bool fits( ::std::size_t size ) const
+        {
+            return record( size ) <= m_capacity / 2;
+        }
+        /* Consumer. Frame is valid until 'pop'. */
+        bool peek( Frame& );
+        void pop();
+        bool isCorrupted() const
+        {
+            return m_is_corrupted;
+        }
+        Control& control()
+        {
+            return * m_control;
+        }
+
+    private :
+        static ::std::size_t record( ::std::size_t size )
+        {
+            return ( sizeof( FrameHeader ) + size + 7 ) & ~static_cast< ::std::size_t >( 7 );
+        }
+
+    private : /*--- Variables ---*/
+        Control * m_control{ nullptr };
+        char * m_data{ nullptr };
+        ::std::size_t m_capacity{ 0 }; //power of two
+        ::std::size_t m_peeked{ 0 }; //size of the record given by 'peek'
+        bool m_is_corrupted{ false }; //peer wrote garbage
+    }; //end class ShmRing
+
+    /* Shared memory data plane of the client-server pair. Client creates 'memfd' with 
+     * two rings ( client -> server and server -> client ) and 'eventfd' for each side, 
+     * and passes them with 'FrameType::SHM_OFFER'. Socket stays the control channel.
+     * Side, that isn't busy with draining its ring, sleeps on its 'eventfd'. 
+     * Producer writes to 'eventfd' only when consumer sleeps, so there are no syscalls 
+     * while both sides are busy. */
+    class ShmChannel
+    {
+    public :
+        using FrameHandler  = ::std::function< void( const Frame& ) >;
+        using DoneHandler   = ::std::function< void() >; //ring is drained
+        using SentHandler   = OutQueue::SentHandler;
+
+    public : /*--- Methods ---*/
+        ShmChannel( IoService&, FrameHandler, DoneHandler, SentHandler );
+        /* Pending wait is cancelled, frames go to the socket's queue again.
+         * Memory stays mapped until destruction, closed channel isn't opened again. */
+        void close();
+        ~ShmChannel();
+        /* Client side, descriptors are for the server. 'capacity' is rounded up to power of two.
+         * Once per channel. */
+        Result create( ::std::size_t& capacity, Fds& );
+        Result open( Fds&, ::std::size_t capacity ); /* Server side */
+
+        /* Thread safe. Until 'startSending' or if frame doesn't fit into the ring, 
+         * it goes to the socket's queue. Frames with descriptors always go through the socket. */
+        Result send( OutFrame&&, OutQueue& );
+        /* Bytes waiting for space in the ring, the rest is dropped. '0' - no limit. */
+        void limit( ::std::size_t max_pending );
+        void measure( Metrics& ); /* Refused frames are counted as overflows */
+        void attach( ::std::weak_ptr< void > owner ); /* Pending notifications keep it alive */
+        /* 'marker' is the last frame sent through the socket */
+        void startSending( OutFrame&& marker, OutQueue& );
+        void startReceiving(); /* Executed by the 'io_service' */
+        bool isOpen() const
+        {
+            return m_memory != nullptr;
+        }
+
+    private :
+        void map( ::std::size_t capacity, bool init );
+        void wait();
+        void drain();
+        void flush(); /* Frames, that were waiting for space */
+        void notify();
+        /* 'SentHandler' runs on the 'io_service', never under 'm_mtx' : it may send again.
+         * Sizes are collected under 'm_mtx', one notification at a time is posted. */
+        bool addSent( ::std::size_t bytes ); //'true' - 'notifySent' should be posted
+        void notifySent();
+
+    private : /*--- Variables ---*/
+        FrameHandler m_frame_handler;
+        DoneHandler m_done_handler;
+        SentHandler m_sent_handler;
+        ::std::weak_ptr< void > m_owner;
+
+        Fd m_memfd;
+        char * m_memory{ nullptr };
+        ::std::size_t m_map_size{ 0 };
+        ShmRing m_out;
+        ShmRing m_in;
+        Fd m_peer_efd;
+        ::boost::asio::posix::stream_descriptor m_wake; //own 'eventfd'
+        ::std::uint64_t m_wake_count{ 0 };
+
+        ::std::mutex m_mtx; //producer side
+        ::std::deque< OutFrame > m_pending; //waiting for space in the ring
+        ::std::size_t m_pending_bytes{ 0 };
+        ::std::size_t m_max_pending{ 0 };
+        Metrics * m_metrics_ptr{ nullptr };
+        ::std::vector< ::std::size_t > m_sent; //written to the ring, not notified yet
+        ::std::vector< ::std::size_t > m_notified; //being notified by the 'io_service'
+
+        /*--- Flags ---*/
+        bool m_is_sending{ false }; //protected by 'm_mtx'
+        bool m_is_notifying{ false }; //protected by 'm_mtx'
+        bool m_is_receiving{ false };
+    }; //end class ShmChannel
+    using ShmChannelUptr = ::std::unique_ptr< ShmChannel >;
+
+    /* Hash map split into independently locked shards.
+     * Operations on different shards never contend, readers of one shard share its lock. */
+    template< typename Key, typename Value, ::std::size_t SHARDS = 16 >
+    class ShardedMap /* Default constructable */
+    {
+    public : /*--- Methods ---*/
+        bool insert( const Key&, const Value& ); /* 'false' if the key is taken */
+        Value find( const Key& ) const; /* Default constructed value if there is no key */
+        bool erase( const Key&, const Value& ); /* Only if the key is still mapped to this value */
+        template< typename Visitor >
+        void forEach( Visitor&& ) const; /* Shard is locked while it's visited */
+        void clear(); /* Values are destroyed out of the locks */
+        ::std::size_t size() const;
+
+    private :
+        using Map = ::std::unordered_map< Key, Value >;
+        struct alignas( 64 ) Shard /* Each lock has its own cache line */
+        {
+            mutable ::std::shared_mutex m_mtx;
+            Map m_map;
+        };
+        Shard& shardOf( const Key& ) const;
+
+    private : /*--- Variables ---*/
+        mutable ::std::array< Shard, SHARDS > m_shards;
+    }; //end class ShardedMap
+
+    /* Dense table addressed by 'ClientHandle' : lookup is two array indexes.
+     * Chunks are never moved, generation tells a reused slot from the stale handle. */
+    template< typename Value >
+    class HandleTable /* Default constructable */
+    {
+    public : /*--- Methods ---*/
+        ClientHandle insert( const Value& ); /* 'INVALID_HANDLE' if the table is full */
+        Value find( ClientHandle ) const; /* Default constructed value for stale handle */
+        bool erase( ClientHandle );
+        void clear(); /* Handles given before are stale after it */
+        ~HandleTable();
+
+    private :
+        static constexpr ::std::size_t CHUNK_SIZE = 1024;
+        static constexpr ::std::size_t MAX_CHUNKS = 1024;
+        struct Slot
+        {
+            mutable ::std::mutex m_mtx; //taken for a copy of the value only
+            ::std::uint32_t m_generation{ 1 }; //never '0', so handle is never 'INVALID_HANDLE'
+            Value m_value;
+        };
+        using Chunk = ::std::array< Slot, CHUNK_SIZE >;
+        Slot * slotOf( ClientHandle ) const;
+
+    private : /*--- Variables ---*/
+        ::std::array< ::std::atomic< Chunk * >, MAX_CHUNKS > m_chunks{};
+        ::std::mutex m_free_mtx; //protects free slots and allocation of chunks
+        ::std::vector< ::std::uint32_t > m_free;
+        ::std::uint32_t m_used{ 0 }; //slots ever handed out
+    }; //end class HandleTable
+
+    /* Set of independent 'io_service's, each one is run by its own thread.
+     * Everything that belongs to one session is bound to one 'io_service',
+     * so handlers of the same session never run concurrently (implicit strand). */
+    class IoPool /* Default constructable */
+    {
+    public :
+        using Index = ::std::size_t;
+
+        enum class Balance //: uint8_t
+        {
+            ROUND_ROBIN     = 0,
+            LEAST_LOADED    = 1 /* 'io_service' with the least number of sessions */
+        };
+
+    public : /*--- Methods ---*/
+        void start( ::std::size_t threads, Balance );
+        void stop();
+        Index acquire(); /* Choose 'io_service' for the new session */
+        void release( Index );
+        IoService& get( Index idx )
+        {
+            return * m_services[ idx ];
+        }
+        ::std::size_t size() const
+        {
+            return m_services.size();
+        }
+        ~IoPool();
+
+    private : /*--- Variables ---*/
+        Balance m_balance{ Balance::ROUND_ROBIN };
+        ::std::vector< IoServiceUptr > m_services;
+        ::std::vector< WorkGuard > m_guards; /* Idle 'io_service' shouldn't return from 'run' */
+        ::std::unique_ptr< ::std::atomic< ::std::size_t >[] > m_load; /* Sessions per 'io_service' */
+        ::std::atomic< Index > m_next{ 0 };
+
+        ::std::vector< ::std::thread > m_workers;
+        ::std::vector< ::std::future<void> > m_futures;
+    }; //end class IoPool
+
     class Server /* Default constructable */
     {
         class Session;
+        class Group;
 
     public :
-        using Sessions = ::std::list< Session >;
-        using SessionHandle = Sessions::iterator;
-        using ConstSessionHandle = const SessionHandle;
-        using IdentifiedSessions = ::std::unordered_map< ClientId, ConstSessionHandle >;
+        /* Owned by the registries and by pending handlers of the session */
+        using SessionShPtr = ::std::shared_ptr< Session >;
+        using Sessions = ShardedMap< const Session *, SessionShPtr >; //all accepted ones
+        using IdentifiedSessions = ShardedMap< ClientId, SessionShPtr >;
+        using GroupShPtr = ::std::shared_ptr< Group >;
+        using Groups = ShardedMap< ClientId, GroupShPtr >;
 
     public : /*--- Classes/structures/enumerators ---*/
         struct Config
@@ -93,6 +880,7 @@ namespace UnixSocket
                  *  <body>
                  *      ...
                  *  </body>
+                 * Not used with 'Framing::LENGTH_PREFIX'.
                  */
             ::std::string   m_id_key;
                 /* for example XML is used for communication.
@@ -102,40 +890,120 @@ namespace UnixSocket
                  * <name>ClientName</name>,
                  * until that no transactions will pass through Session class.
                  */
+            Framing         m_framing = Framing::DELIMITER; //how messages are separated in the stream
+            Transport       m_transport = Transport::STREAM;
+            ::std::size_t   m_max_packet = 64 * 1024; //'Transport::SEQPACKET' : bigger packets are error
+
+            /* If provided, receives all frames cut out of one read at once
+             * instead of calling 'm_recv_cb' for each one. */
+            ::std::function< RecvBatchCallBack > m_recv_batch_cb;
+
+            /* If provided, receives frames without any copy,
+             * has precedence over 'm_recv_batch_cb' and 'm_recv_cb'. */
+            ::std::function< RecvViewCallBack > m_recv_view_cb;
+
+            /* Accept descriptors sent by 'sendFds' ('Framing::LENGTH_PREFIX' only).
+             * Costs 'recvmsg' instead of plain read. Frames with descriptors go to 
+             * 'm_recv_fds_cb', if it isn't provided descriptors are closed. */
+            bool m_pass_fds = false;
+            ::std::function< RecvFdsCallBack > m_recv_fds_cb;
+
+            /* Accept clients' offers of the shared memory data plane, needs 'm_pass_fds'. */
+            bool m_allow_shm = false;
+
+            /* 'Handshake::BINARY' needs no 'm_id_key' and no XML parsing. Should match client's one. */
+            Handshake m_handshake = Handshake::XML;
+
+            /* If provided, called at identification with credentials of the client's process.
+             * Session is dropped if it returns 'false'. */
+            ::std::function< PeerCheckCallBack > m_peer_check_cb;
+
+            /* Handle based variants, used instead of the name based ones if provided.
+             * 'm_identified_cb' tells once which handle the client got. */
+            ::std::function< RecvHandleCallBack >  m_recv_handle_cb;
+            ::std::function< SendHandleCallBack >  m_send_handle_cb;
+            ::std::function< ErrorHandleCallBack > m_error_handle_cb;
+            ::std::function< IdentifiedCallBack >  m_identified_cb;
+
+            /* Bound of the data queued for each client, look 'Watermarks' */
+            Watermarks m_watermarks;
+            ::std::function< WatermarkCallBack > m_watermark_cb;
+
+            ::std::size_t   m_io_threads = 1;
+                /* Number of I/O threads, each one with its own 'io_service'.
+                 * '0' - one thread per core. */
+            IoPool::Balance m_balance = IoPool::Balance::ROUND_ROBIN;
+                /* How accepted sessions are spread between I/O threads */
+
+            ::std::size_t   m_chunk_size = 0;
+                /* 'Framing::LENGTH_PREFIX' with 'Transport::STREAM' : bigger messages are written
+                 * in pieces of this size, so frames of higher 'Priority' aren't stuck behind them.
+                 * Peer glues pieces back. Applies to clients, that identified with 'CAP_CHUNKS'.
+                 * '0' - messages are never split. */
 
         }; //end struct Config
 
+        /* Snapshot of the server, look 'stats' */
+        struct Stats
+        {
+            ::std::chrono::milliseconds m_uptime{ 0 }; //since 'start'
+            ::std::uint64_t m_accepted = 0;
+            double          m_accept_rate = 0; //accepted per second of 'm_uptime'
+            ::std::uint64_t m_accept_errors = 0;
+            ::std::uint64_t m_rejected = 0; //failed identification or peer check
+            /* Connections are removed on error, so their errors are summed up here */
+            ::std::uint64_t m_read_errors = 0;
+            ::std::uint64_t m_write_errors = 0;
+            Histogram::Snapshot m_identification; //since accept, of all identified sessions
+            ::std::vector< ConnectionStats > m_sessions; //opened ones
+        };
+
     private : /* No access to the Sessions from outside */
-        class Session
+        class Session : public ::std::enable_shared_from_this< Session >
         {
             friend class Server;
         public : /*--- Methods ---*/
-            Session( IoService& io_service, Server * parent )
-                : m_io_service_ref( io_service ),
-                m_socket( io_service ),
-                m_parent_ptr( parent )
-            { }
+            Session( IoService& io_service, IoPool::Index io_index, Server * parent );
+            void start(); /* Once accepted and owned by 'SessionShPtr' */
+            void close(); /* Cancels pending operations, their handlers release the session */
             void recv();
-            Result identification( const ::std::string& );
+            void received( ::std::size_t bytes_transferred );
+            void deliver( const Frame& );
+            bool control( const Frame& ); /* Handle service frames */
+            void flushBatch();
+            void readError( const ErrCode& );
+            void writeError( const ErrCode& );
+            Result identification( const Frame& );
             template< typename Data >
-            void send( Data&& );
-            void saveHandle( SessionHandle self )
-            {
-                m_self = self;
-            }
+            Result send( Data&&, Fds&& fds = Fds{}, Priority priority = Priority::NORMAL );
+            Result push( OutFrame&& ); /* Shared memory or socket */
+            void notifySent( ::std::size_t bytes );
+            void notifyError( const ErrorDescription& );
+            ConnectionStats stats();
             ~Session();
         private : /*--- Variables ---*/
             IoService& m_io_service_ref;
+            IoPool::Index m_io_index; //slot in the 'Server::m_io_pool'
             Socket m_socket;
             Server * m_parent_ptr;
             const int READ_BUF_SIZE = 1024;
-            ::std::string m_read_buf;
-            SessionHandle m_self;
-                // save iterator to yourself
-                // used in identification process
+            const ::std::string m_end_tag; //'Framing::DELIMITER'
+            const ::std::string m_id_tag; //end of the XML identification
+            InBuffer m_read_buf; //session's handlers never run concurrently
+            ::std::string m_frame_buf; //reused for each 'm_recv_cb' call
+            Batch m_batch;
+            ::std::size_t m_batch_len = 0;
+            ::std::deque< Fd > m_fds; //received, but not delivered yet
+            Fds m_frame_fds;
+            OutQueue m_out_queue;
+            ShmChannelUptr m_shm_uptr; //exists if shared memory is allowed
 
             ::std::string m_client_id; //Identification of remote client for this session
-            /* Sessions are stored at server side by principle : 'm_client_id' -> 'm_self' */
+            /* Sessions are stored at server side by principle : 'm_client_id' -> session */
+            ClientHandle m_handle{ INVALID_HANDLE }; //given at identification
+            ::std::weak_ptr< Group > m_group; //set if the session is the member of the group
+            Metrics m_metrics;
+            StatsClock::time_point m_accepted_at{};
         private : /*--- Flags ---*/
             ::std::atomic< bool > m_is_identified{ false };
 
@@ -146,6 +1014,22 @@ namespace UnixSocket
             ::std::atomic< bool > m_is_valid{ true };
         }; /* end class Session */
 
+        /* Connections, that identified with the same name as members of the group ( 'CAP_GROUP' ).
+         * Server sees them as one client : data for the name goes to any of them. */
+        class Group
+        {
+        public : /*--- Methods ---*/
+            bool join( const SessionShPtr& ); /* 'false' if the last member has left meanwhile */
+            bool leave( const Session * ); /* 'true' if it was the last member */
+            SessionShPtr pick(); /* Round robin */
+            SessionShPtr pick( OrderKey ); /* Same member for the key, while group isn't changed */
+        private : /*--- Variables ---*/
+            ::std::shared_mutex m_mtx;
+            ::std::vector< SessionShPtr > m_members;
+            ::std::atomic< ::std::size_t > m_next{ 0 };
+            bool m_is_closed{ false }; //last member has left, group is being erased
+        }; //end class Group
+
     private : /*--- Getters and Setters ---*/
         Config& getConfig()
         {
@@ -166,6 +1050,31 @@ namespace UnixSocket
         template< typename Data >
         Result send( const ::std::string& , Data&& );
         template< typename Data >
+        Result send( ClientHandle, Data&& ); /* No hashing of the name */
+        /* Lane of the client's queue, look 'Priority' */
+        template< typename Data >
+        Result send( const ::std::string&, Priority, Data&& );
+        template< typename Data >
+        Result send( ClientHandle, Priority, Data&& );
+        /* Group of the clients : frames with the same key keep their order */
+        template< typename Data >
+        Result send( const ::std::string&, OrderKey, Data&& );
+        /* Descriptors are duplicated, caller keeps its own ones */
+        template< typename Data >
+        Result sendFds( const ::std::string& , Data&&, const ::std::vector< int >& );
+        template< typename Data >
+        Result sendFds( ClientHandle, Data&&, const ::std::vector< int >& );
+        /* Chunks are one message, written by one gathered write without concatenation */
+        Result sendChunks( const ::std::string&, Chunks&& );
+        Result sendChunks( ClientHandle, Chunks&& );
+        /* Name <-> handle mapping of the connected clients, for one time lookup */
+        ClientHandle handleOf( const ClientId& );
+        ClientId nameOf( ClientHandle );
+        /* Counters are always on, snapshot may be taken from any thread */
+        Stats stats();
+        /* Each client gets the data, even if some of them fail. Result is the worst one : 
+         * 'Result::SEND_ERROR', then 'Result::WOULD_BLOCK', otherwise 'Result::SEND_SUCCESS'. */
+        template< typename Data >
         Result broadCast( Data&& ); /* Send to all clients */
         template< typename Data >
         Result multiCast( Data&& ); /* Send to all identified clients */
@@ -173,7 +1082,14 @@ namespace UnixSocket
         ~Server();
 
     private :
-        void removeSession( SessionHandle& );
+        void removeSession( const SessionShPtr& );
+        Result sendAll( const ::std::vector< SessionShPtr >&, const ConstBufferShPtr& );
+        bool joinGroup( const SessionShPtr& ); /* Identified group member */
+        /* Single client or any member of the group */
+        SessionShPtr findClient( const ClientId& );
+        SessionShPtr findClient( const ClientId&, OrderKey );
+        template< typename Data >
+        Result sendFds( const SessionShPtr&, Data&&, const ::std::vector< int >& );
         void accept();
 
     private : /*--- Variables ---*/
@@ -181,26 +1097,47 @@ namespace UnixSocket
         Config m_config;
         AcceptorUptr m_acceptor_uptr;
 
-         /* Server should know about all opened sessions */
+         /* Server should know about all opened sessions.
+          * Registries are thread safe, 'send' from many threads doesn't serialize. */
         Sessions m_sessions;
         IdentifiedSessions m_id_sessions_map;
-        ::std::mutex m_sessions_mtx; //protect access to the sessions data
+        Groups m_groups; //names are never both in 'm_id_sessions_map' and here
+        HandleTable< SessionShPtr > m_handles;
 
-        IoService m_io_service; /* Initialized with class creation */
-        ::std::thread m_worker;
-        ::std::future<void> m_future;
+        IoPool m_io_pool; /* Acceptor lives in the first 'io_service' */
+
+        /*--- Statistics ---*/
+        StatsClock::time_point m_started_at{};
+        ::std::atomic< ::std::uint64_t > m_accepted{ 0 };
+        ::std::atomic< ::std::uint64_t > m_accept_errors{ 0 };
+        ::std::atomic< ::std::uint64_t > m_rejected{ 0 };
+        ::std::atomic< ::std::uint64_t > m_read_errors{ 0 };
+        ::std::atomic< ::std::uint64_t > m_write_errors{ 0 };
+        Histogram m_identification;
 
         /*--- Flags ---*/
         ::std::atomic< bool > m_is_configured{ false };
     }; //end class Server
 
+    /* Delays between connection attempts : the first one is 'm_min_delay', each failure
+     * doubles it up to 'm_max_delay'. Random share up to 'm_jitter' is taken off the delay,
+     * so clients of the restarted server don't come back all at once. */
+    struct Backoff
+    {
+        ::std::chrono::milliseconds m_min_delay{ 100 };
+        ::std::chrono::milliseconds m_max_delay{ 10000 };
+        double m_jitter = 0.5; //[0, 1]
+        ::std::size_t m_max_attempts = 0; //failed in a row, short silent connections too. '0' - no limit
+    };
+
     class Client /* Default constructable */
     {
+        friend class RpcClient; /* Its timers run on the client's 'io_service' */
     public :
         enum class ConnectType //: uint8_t
         {
             ASYNC_CONNECT   = 0,
-            SYNC_CONNECT    = 1
+            SYNC_CONNECT    = 1  /* First attempt is made in 'start', the rest are asynchronous */
         };
 
         struct Config
@@ -216,6 +1153,39 @@ namespace UnixSocket
             ::std::string   m_id_key; //look 'Server::Config'
             ::std::string   m_client_id;
             ConnectType     m_con_type;
+            Framing         m_framing = Framing::DELIMITER; //should match server's one
+            Transport       m_transport = Transport::STREAM; //should match server's one
+            ::std::size_t   m_max_packet = 64 * 1024; //look 'Server::Config'
+            ::std::function< RecvBatchCallBack > m_recv_batch_cb; //look 'Server::Config'
+            ::std::function< RecvViewCallBack > m_recv_view_cb; //look 'Server::Config'
+            bool m_pass_fds = false; //look 'Server::Config'
+            ::std::function< RecvFdsCallBack > m_recv_fds_cb;
+
+            /* Size of each ring of the shared memory data plane, '0' - don't offer it.
+             * Needs 'Framing::LENGTH_PREFIX'. Frames, that don't fit into the half 
+             * of the ring, go through the socket and may overtake the ring. */
+            ::std::size_t m_shm_size = 0;
+            Handshake m_handshake = Handshake::XML; //should match server's one
+            Watermarks m_watermarks; //look 'Server::Config'
+            ::std::function< WatermarkCallBack > m_watermark_cb;
+
+            /* Failed or lost connection is retried after 'm_backoff' delay and client 
+             * identifies itself again. Frames queued, but not written, are lost with 
+             * the connection. Shared memory isn't offered again, socket is used. */
+            bool m_reconnect = true;
+            Backoff m_backoff;
+            /* Bytes sent while there is no connection are kept and sent after identification,
+             * '0' - such 'send' fails. Descriptors aren't kept. */
+            ::std::size_t m_offline_bytes = 0;
+            bool m_group = false; //identify as the member of the group, look 'ClientPool'
+            ::std::size_t m_chunk_size = 0; //look 'Server::Config', server should be of this version
+        };
+
+        /* Snapshot of the client, look 'stats' */
+        struct Stats : ConnectionStats
+        {
+            ::std::uint64_t m_connects = 0; //successful ones, reconnects included
+            ::std::uint64_t m_connect_failures = 0;
         };
     public : /*--- Methods ---*/
 
@@ -223,12 +1193,34 @@ namespace UnixSocket
         Result start();
 
         template< typename Data >
-        void send( Data&& );
+        Result send( Data&& );
+        template< typename Data >
+        Result send( Priority, Data&& ); /* Lane of the queue, look 'Priority' */
+        /* Descriptors are duplicated, caller keeps its own ones */
+        template< typename Data >
+        Result sendFds( Data&&, const ::std::vector< int >& );
+        Result sendChunks( Chunks&& ); /* One message, look 'Server::sendChunks' */
+        void stop(); /* I/O thread is joined, no callbacks after it */
+        Stats stats(); /* Counters are always on, snapshot may be taken from any thread */
         ~Client();
     private :
         void connect( ConnectType );
+        void connected(); /* Identify, flush offline frames and read */
+        void lost( const ErrCode& ); /* Connection is broken */
+        void retry(); /* Next attempt after the backoff delay */
+        ::std::chrono::milliseconds backoff();
+        Result sendOffline( OutFrame&& ); /* Thread safe */
+        Result push( OutFrame&& ); /* Offline, shared memory or socket */
         void recv();
+        void received( ::std::size_t bytes_transferred );
+        void deliver( const Frame& );
+        bool control( const Frame& ); /* Handle service frames */
+        void flushBatch();
+        void readError( const ErrCode& );
+        void writeError( const ErrCode& );
         void identify();
+        void offerShm();
+        void notifySent( ::std::size_t bytes );
 
     private : /*--- Variables ---*/
         Config m_config;
@@ -240,26 +1232,499 @@ namespace UnixSocket
         ::std::thread m_worker;
         ::std::future<void> m_future;
 
+        ::boost::asio::steady_timer m_retry_timer{ m_io_service };
+        ::std::size_t m_attempts = 0; //failed in a row, look 'Client::lost'
+        ::std::uint64_t m_frames_at_connect = 0; //'m_metrics.m_frames_in' of the current connection
+        ::std::minstd_rand m_random{ ::std::random_device{}() }; //jitter
+
+        ::std::mutex m_offline_mtx; //protects 'm_offline' and the switch of 'm_is_connected'
+        OutFrames m_offline;
+        ::std::size_t m_offline_size = 0;
+
         const int READ_BUF_SIZE = 1024;
-        ::std::string m_read_buf;
+        ::std::string m_end_tag; //'Framing::DELIMITER', built at 'start'
+        InBuffer m_read_buf;
+        ::std::string m_frame_buf; //reused for each 'm_recv_cb' call
+        Batch m_batch;
+        ::std::size_t m_batch_len = 0;
+        ::std::deque< Fd > m_fds; //received, but not delivered yet
+        Fds m_frame_fds;
+        OutQueue m_out_queue;
+        ShmChannelUptr m_shm_uptr; //exists if shared memory is configured
+
+        /*--- Statistics ---*/
+        Metrics m_metrics;
+        StatsClock::time_point m_connect_at{}; //of the current attempt
+        ::std::atomic< ::std::uint64_t > m_connects{ 0 };
+        ::std::atomic< ::std::uint64_t > m_connect_failures{ 0 };
 
         /*--- Flags ---*/
         ::std::atomic< bool > m_is_configured{ false };
         ::std::atomic<bool> m_is_connected{ false };
     }; //end class client
+
+    /* Several connections of one producer to the same 'Server', each one with its own socket
+     * and I/O thread. All of them identify with 'm_client_id' as members of the group, 
+     * so server sees one client. Callbacks are called from all I/O threads. */
+    class ClientPool /* Default constructable */
+    {
+    public :
+        struct Config
+        {
+            Client::Config m_client; //shared by all connections, 'm_group' is set by the pool
+            ::std::size_t m_connections = 4;
+        };
+    public : /*--- Methods ---*/
+        Result setConfig( Config&& );
+        Result start();
+        /* Connections are taken round robin, the one that can't take the frame is skipped.
+         * Frames may be reordered. */
+        template< typename Data >
+        Result send( Data&& );
+        /* Frames with the same key go through the same connection and keep their order */
+        template< typename Data >
+        Result send( OrderKey, Data&& );
+        ::std::size_t size() const
+        {
+            return m_clients.size();
+        }
+
+    private : /*--- Variables ---*/
+        Config m_config;
+        ::std::vector< ::std::unique_ptr< Client > > m_clients;
+        ::std::atomic< ::std::size_t > m_next{ 0 };
+
+        /*--- Flags ---*/
+        ::std::atomic< bool > m_is_configured{ false };
+    }; //end class ClientPool
+
+    /*----------------------*/
+    /*--- Typed messages ---*/
+    /*----------------------*/
+    /* Typed message is 'MessageHeader' followed by the encoded body.
+     * Needs 'Framing::LENGTH_PREFIX' or 'Framing::PACKET' : header is binary. */
+    using MessageType = ::std::uint16_t;
+    struct MessageHeader
+    {
+        MessageType m_type;
+    };
+    static_assert( sizeof( MessageHeader ) == 2, "MessageHeader should be packed" );
+
+    /* Tag of the type on the wire, unique among the types of one connection.
+     * Specialize it at the global scope : UNIX_SOCKET_MESSAGE( Position, 1 ) */
+    template< typename T >
+    struct MessageTag;
+
+#define UNIX_SOCKET_MESSAGE( Type, tag ) \
+    template<> struct UnixSocket::MessageTag< Type > \
+        : ::std::integral_constant< ::UnixSocket::MessageType, tag > {}
+
+    template< typename T, typename Enable = void >
+    struct IsMessage : ::std::false_type {};
+    template< typename T >
+    struct IsMessage< T, ::std::void_t< decltype( MessageTag< T >::value ) > > : ::std::true_type {};
+
+    /* Encoding of the body. Trivially copyable types are copied as they are : both ends live 
+     * on the same host. Any other type needs a specialization with the same members :
+     *  template<> struct UnixSocket::Codec< Order >
+     *  {
+     *      static ::std::size_t size( const Order& );
+     *      static void encode( const Order&, char * out ); //exactly 'size' bytes
+     *      static bool decode( const char * data, ::std::size_t size, Order& ); //'false' if malformed
+     *  }; */
+    template< typename T, typename Enable = void >
+    struct Codec
+    {
+        static_assert( sizeof( T ) == 0, "Type is not trivially copyable, specialize 'Codec' for it" );
+    };
+    template< typename T >
+    struct Codec< T, ::std::enable_if_t< ::std::is_trivially_copyable< T >::value > >
+    {
+        static constexpr ::std::size_t size( const T& )
+        {
+            return sizeof( T );
+        }
+        static void encode( const T& message, char * out )
+        {
+            ::std::memcpy( out, & message, sizeof( T ) );
+        }
+        static bool decode( const char * data, ::std::size_t size, T& message )
+        {
+            if( size != sizeof( T ) ) { return false; }
+            ::std::memcpy( & message, data, sizeof( T ) );
+            return true;
+        }
+    };
+
+    /* Encodes straight into the payload, which is sent without further copies.
+     * 'send' does it by itself for the types with 'MessageTag'. */
+    template< typename T >
+    ConstBufferShPtr encodeMessage( const T& );
+    /* 'false' if the frame carries another type or is malformed */
+    template< typename T >
+    bool decodeMessage( const Frame&, T& );
+
+    /* Routes typed frames to 'Handler' by the type tag. Handler is an overload of
+     * 'operator()( const ClientId&, const T& )' for each of 'Messages', the choice is
+     * made at compile time. Fits 'm_recv_view_cb' of the server and the client :
+     *  config.m_recv_view_cb = ::std::ref( dispatcher ); */
+    template< typename Handler, typename... Messages >
+    class Dispatcher
+    {
+        static_assert( sizeof...( Messages ) > 0, "Dispatcher needs at least one message type" );
+
+    public :
+        explicit Dispatcher( Handler handler = Handler() ) : m_handler( ::std::move( handler ) ) {}
+
+        /* 'false' if the type is unknown or the body is malformed */
+        bool operator()( const ClientId&, const Frame& );
+        Handler& handler() { return m_handler; }
+
+    private :
+        static constexpr bool hasUniqueTags();
+
+        template< typename T >
+        bool deliver( const ClientId&, const char * body, ::std::size_t size );
+
+        Handler m_handler;
+    }; //end class Dispatcher
+
+    /*-----------*/
+    /*--- RPC ---*/
+    /*-----------*/
+    /* Request and reply are 'RpcHeader' followed by the data.
+     * Needs 'Framing::LENGTH_PREFIX' or 'Framing::PACKET' : header is binary. */
+    using CallId = ::std::uint64_t;
+    struct RpcHeader
+    {
+        CallId m_call_id; //reply carries the one of its request
+    };
+    static_assert( sizeof( RpcHeader ) == 8, "RpcHeader should be packed" );
+
+    template< typename Data >
+    Buffer makeRpcFrame( CallId, const Data& );
+
+    /* Calls of the 'RpcServer' over one connection. Any number of calls may be in flight,
+     * replies are matched by 'CallId' and may come in any order. */
+    class RpcClient /* Default constructable */
+    {
+    public :
+        /* 'Result::ALL_GOOD' with the reply, 'Result::TIMED_OUT' with the empty string */
+        using ReplyHandler = ::std::function< void( Result, ::std::string& ) >;
+
+        struct Config
+        {
+            Client::Config m_client; //receive callbacks are taken by the RPC layer
+            ::std::chrono::milliseconds m_timeout{ 1000 }; //of each call, '0' - no timeout
+        };
+    public : /*--- Methods ---*/
+        Result setConfig( Config&& );
+        Result start();
+        /* Handler is called by the I/O thread. It isn't called, if request isn't sent,
+         * unless the call has timed out during the send : then it's 'Result::TIMED_OUT'. */
+        template< typename Data >
+        Result call( Data&& request, ReplyHandler, 
+            ::std::chrono::milliseconds timeout = ::std::chrono::milliseconds::zero() );
+        /* Future throws 'std::runtime_error' if there is no reply */
+        template< typename Data >
+        ::std::future< ::std::string > call( Data&& request );
+        ~RpcClient();
+
+    private :
+        Result send( CallId, Buffer&&, ReplyHandler, ::std::chrono::milliseconds timeout );
+        void received( const Frame& );
+        void complete( CallId, Result, ::std::string& reply );
+
+    private : /*--- Variables ---*/
+        struct Call
+        {
+            ReplyHandler m_handler;
+            ::std::unique_ptr< ::boost::asio::steady_timer > m_timer;
+        };
+
+        Config m_config;
+        Client m_client; //destroyed after the timers of 'm_calls'
+        ::std::mutex m_mtx; //protects 'm_calls'
+        ::std::unordered_map< CallId, Call > m_calls; //in flight
+        ::std::atomic< CallId > m_next_id{ 1 };
+        ::std::string m_reply_buf; //reused for each reply
+    }; //end class RpcClient
+
+    /* Answers 'RpcClient's. Reply may be sent from the handler or later from any thread. */
+    class RpcServer /* Default constructable */
+    {
+    public :
+        class Reply
+        {
+            friend class RpcServer;
+        public : /*--- Methods ---*/
+            template< typename Data >
+            Result operator()( Data&& ) const; /* Once */
+            ClientHandle client() const
+            {
+                return m_handle;
+            }
+        private :
+            Reply( Server * server, ClientHandle handle, CallId call_id )
+                : m_server_ptr( server ), m_handle( handle ), m_call_id( call_id )
+            { }
+        private : /*--- Variables ---*/
+            Server * m_server_ptr;
+            ClientHandle m_handle; //reply goes to the connection of the request
+            CallId m_call_id;
+        }; //end class Reply
+
+        using RequestHandler = void( ClientHandle, ::std::string&, const Reply& );
+
+        struct Config
+        {
+            Server::Config m_server; //receive callbacks are taken by the RPC layer
+            ::std::function< RequestHandler > m_request_cb;
+        };
+    public : /*--- Methods ---*/
+        Result setConfig( Config&& );
+        Result start();
+        ClientId nameOf( ClientHandle handle )
+        {
+            return m_server.nameOf( handle );
+        }
+
+    private :
+        void received( ClientHandle, ::std::string& );
+
+    private : /*--- Variables ---*/
+        Config m_config;
+        Server m_server;
+    }; //end class RpcServer
+
+#ifdef BOOST_ASIO_HAS_CO_AWAIT
+    /*------------------*/
+    /*--- Coroutines ---*/
+    /*------------------*/
+    /* C++20 only. Header only, library itself may be built as C++17. */
+    template< typename Type >
+    using Awaitable = ::boost::asio::awaitable< Type >;
+
+    struct CoConfig
+    {
+        ::std::string   m_address;
+        ::std::string   m_delimiter; //look 'Server::Config'
+        ::std::string   m_id_key; //look 'Server::Config'
+        ::std::string   m_client_id; //'CoClient' only
+        Framing         m_framing = Framing::DELIMITER;
+        Transport       m_transport = Transport::STREAM;
+        ::std::size_t   m_max_packet = 64 * 1024;
+        Handshake       m_handshake = Handshake::XML;
+    };
+
+    /* Connection driven by the coroutine : frames are awaited instead of callbacks, 
+     * there is no queue and no 'std::function' on the way. Wire is the one of 
+     * 'Server' and 'Client', so they may talk to each other. No shared memory, no descriptors.
+     * One 'recv' and one 'send' may be awaited at a time. */
+    class CoSession
+    {
+    public : /*--- Methods ---*/
+        CoSession( Socket&&, const CoConfig&, bool is_identified );
+        /* Server side : the first call waits for the identification too.
+         * Frame points into the session's buffer, it's valid until the next 'recv'. */
+        Awaitable< Result > recv( Frame& );
+        /* 'data' should be alive until the send is done */
+        template< typename Data >
+        Awaitable< Result > send( const Data& data );
+        const ClientId& clientId() const /* Known after the first 'recv' at the server side */
+        {
+            return m_client_id;
+        }
+        Socket& socket()
+        {
+            return m_socket;
+        }
+
+    protected :
+        Awaitable< Result > identify();
+        Awaitable< Result > next( Frame&, Framing, const ::std::string& end_tag );
+        Awaitable< Result > write( FrameHeader, ::boost::asio::const_buffer );
+
+    protected : /*--- Variables ---*/
+        Socket m_socket;
+        CoConfig m_config;
+        ::std::string m_end_tag;
+        ::std::string m_id_tag;
+        const int READ_BUF_SIZE = 1024;
+        InBuffer m_read_buf;
+        ::std::deque< Fd > m_fds; //'recvWithFds' needs them, nobody takes them
+        ClientId m_client_id;
+        bool m_is_identified;
+    }; //end class CoSession
+    using CoSessionUptr = ::std::unique_ptr< CoSession >;
+
+    class CoServer /* Default constructable */
+    {
+    public : /*--- Methods ---*/
+        Result setConfig( CoConfig&& );
+        Result start( IoService& ); /* Coroutines are run by the caller's 'io_service' */
+        /* Next connected client, 'nullptr' when the server is closed */
+        Awaitable< CoSessionUptr > accept();
+        void close();
+
+    private : /*--- Variables ---*/
+        CoConfig m_config;
+        AcceptorUptr m_acceptor_uptr;
+    }; //end class CoServer
+
+    class CoClient : public CoSession
+    {
+    public : /*--- Methods ---*/
+        explicit CoClient( IoService& io_service )
+            : CoSession( Socket( io_service ), CoConfig{}, true )
+        { }
+        Result setConfig( CoConfig&& );
+        Awaitable< Result > connect(); /* Connects and identifies */
+    }; //end class CoClient
+#endif /* BOOST_ASIO_HAS_CO_AWAIT */
+
+    /*----------------*/
+    /*--- Datagram ---*/
+    /*----------------*/
+    using DgramProtocol = ::boost::asio::local::datagram_protocol;
+    using DgramSocket   = DgramProtocol::socket;
+    using DgramEndPoint = DgramProtocol::endpoint;
+
+    /* Connectionless receiver for fire-and-forget senders.
+     * No accept, no 'Session' and no identification : 
+     * sender is identified by the address its socket is bound to. */
+    class DgramServer /* Default constructable */
+    {
+    public :
+        struct Config
+        {
+            ::std::function< RecvCallBack >   m_recv_cb; //one datagram per call
+            ::std::function< ErrorCallBack >  m_error_cb;
+            ::std::string   m_address; //file to bind to
+            ::std::size_t   m_max_packet = 64 * 1024; //bigger datagrams are dropped
+        };
+    public : /*--- Methods ---*/
+        Result setConfig( Config&& );
+        Result start();
+        ~DgramServer();
+    private :
+        void recv();
+        void received( ::std::size_t bytes_transferred );
+
+    private : /*--- Variables ---*/
+        Config m_config;
+        IoService m_io_service;
+        ::std::thread m_worker;
+        ::std::future<void> m_future;
+
+        ::std::unique_ptr< DgramSocket > m_socket_uptr;
+        DgramEndPoint m_sender; //filled by each receive
+        ClientId m_sender_id;
+        ::std::string m_frame_buf; //reused for each 'm_recv_cb' call
+
+        /*--- Flags ---*/
+        ::std::atomic< bool > m_is_configured{ false };
+    }; //end class DgramServer
+
+    /* Sender never reads and waits at most 'm_send_timeout' : if the server can't take 
+     * the datagram in time, it is dropped. Safe to call from any thread. */
+    class DgramClient /* Default constructable */
+    {
+    public :
+        struct Config
+        {
+            ::std::function< ErrorCallBack >  m_error_cb; //optional
+            ::std::string   m_address; //file to send to
+            ::std::string   m_client_id; //bound as abstract address, should be unique
+            /* How long 'send' may wait when server's queue is full ('net.unix.max_dgram_qlen'),
+             * '0' - drop the datagram at once */
+            ::std::chrono::milliseconds m_send_timeout{ 0 };
+        };
+    public : /*--- Methods ---*/
+        Result setConfig( Config&& );
+        Result start();
+        template< typename Data >
+        Result send( Data&& );
+        ~DgramClient();
+    private :
+        Result sendBuffer( ::boost::asio::const_buffer );
+        bool connect();
+
+    private : /*--- Variables ---*/
+        Config m_config;
+        IoService m_io_service; //never run, all operations are synchronous
+        ::std::unique_ptr< DgramSocket > m_socket_uptr;
+        ::std::mutex m_connect_mtx;
+
+        /*--- Flags ---*/
+        ::std::atomic< bool > m_is_configured{ false };
+        /* Connected socket skips the path lookup on each send */
+        ::std::atomic< bool > m_is_connected{ false };
+    }; //end class DgramClient
 }
 
 /* c-style helpers */
 #define ERR_CHECK(val, msg) \
     if( val == "" ) \
     { \
-        PRINT_ERR( "No %s provided.\n", msg ); \
+        ERROR_LOG( "No %s provided.\n", msg ); \
         return Result::CFG_ERROR; \
     }
 
+/* Log levels, set 'UNIX_SOCKET_LOG_LEVEL' at compile time to choose */
+#define UNIX_SOCKET_LOG_TRACE   0 /* Every frame */
+#define UNIX_SOCKET_LOG_DEBUG   1 /* Every connection */
+#define UNIX_SOCKET_LOG_INFO    2 /* Start, stop and configuration */
+#define UNIX_SOCKET_LOG_ERROR   3
+#define UNIX_SOCKET_LOG_NONE    4
+
+#ifndef UNIX_SOCKET_LOG_LEVEL
+#ifdef NDEBUG
+#define UNIX_SOCKET_LOG_LEVEL UNIX_SOCKET_LOG_INFO
+#else
+#define UNIX_SOCKET_LOG_LEVEL UNIX_SOCKET_LOG_TRACE
+#endif
+#endif
+
+#define UNIX_SOCKET_LOG( level, color, ... ) \
+    ::UnixSocket::Logger::instance().log( level, color, __func__, __LINE__, __VA_ARGS__ )
+
+/* Arguments of the disabled level aren't evaluated */
+#if UNIX_SOCKET_LOG_LEVEL <= UNIX_SOCKET_LOG_TRACE
+#define TRACE_LOG( color, ... ) UNIX_SOCKET_LOG( UNIX_SOCKET_LOG_TRACE, color, __VA_ARGS__ )
+#else
+#define TRACE_LOG( color, ... ) do { } while( 0 )
+#endif
+
+#if UNIX_SOCKET_LOG_LEVEL <= UNIX_SOCKET_LOG_DEBUG
+#define DEBUG_LOG( color, ... ) UNIX_SOCKET_LOG( UNIX_SOCKET_LOG_DEBUG, color, __VA_ARGS__ )
+#else
+#define DEBUG_LOG( color, ... ) do { } while( 0 )
+#endif
+
+#if UNIX_SOCKET_LOG_LEVEL <= UNIX_SOCKET_LOG_INFO
+#define INFO_LOG( color, ... ) UNIX_SOCKET_LOG( UNIX_SOCKET_LOG_INFO, color, __VA_ARGS__ )
+#else
+#define INFO_LOG( color, ... ) do { } while( 0 )
+#endif
+
+#if UNIX_SOCKET_LOG_LEVEL <= UNIX_SOCKET_LOG_ERROR
+#define ERROR_LOG( ... ) UNIX_SOCKET_LOG( UNIX_SOCKET_LOG_ERROR, RED, __VA_ARGS__ )
+#else
+#define ERROR_LOG( ... ) do { } while( 0 )
+#endif
+
+#include "UnixSocketShardedMap.hpp"
+#include "UnixSocketHandleTable.hpp"
+#include "UnixSocketOutQueue.hpp"
+#include "UnixSocketCodec.hpp"
 #include "UnixSocketClient.hpp"
+#include "UnixSocketClientPool.hpp"
+#include "UnixSocketRpc.hpp"
+#include "UnixSocketCoro.hpp"
 #include "UnixSocketServer.hpp"
 #include "UnixSocketSession.hpp"
+#include "UnixSocketDgram.hpp"
 
 
 #endif /* UNIX_SOCKET_H*/
\ No newline at end of file
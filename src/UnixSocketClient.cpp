@@ -9,21 +9,42 @@ Result Client::setConfig( Config&& cfg )
 {
     m_config = cfg;
     ERR_CHECK( m_config.m_address,     "file name" );
-    ERR_CHECK( m_config.m_id_key,      "identification" );
-    ERR_CHECK( m_config.m_delimiter,   "delimiter" );
+    if( m_config.m_handshake == Handshake::XML )
+    {
+        ERR_CHECK( m_config.m_id_key,      "identification" );
+    }
+    if( m_config.m_framing == Framing::DELIMITER )
+    {
+        ERR_CHECK( m_config.m_delimiter,   "delimiter" );
+    }
     ERR_CHECK( m_config.m_client_id,   "client name" );
-    if( ! m_config.m_recv_cb )
+    if( m_config.m_client_id.size() > MAX_ID_LENGTH )
     {
-        PRINT_ERR( "No read callback provided.\n" );
+        ERROR_LOG( "Client name is too long.\n" );
+        return Result::CFG_ERROR;
+    }
+    if( m_config.m_framing == Framing::PACKET && m_config.m_transport != Transport::SEQPACKET )
+    {
+        ERROR_LOG( "Packet framing needs seqpacket transport.\n" );
+        return Result::CFG_ERROR;
+    }
+    if( m_config.m_shm_size != 0 && m_config.m_framing != Framing::LENGTH_PREFIX )
+    {
+        ERROR_LOG( "Shared memory needs length prefixed framing.\n" );
+        return Result::CFG_ERROR;
+    }
+    if( ! m_config.m_recv_cb && ! m_config.m_recv_view_cb )
+    {
+        ERROR_LOG( "No read callback provided.\n" );
         return Result::CFG_ERROR;
     }
     if( ! m_config.m_send_cb )
     {
-        PRINT_ERR( "No send callback provided.\n" );
+        ERROR_LOG( "No send callback provided.\n" );
         return Result::CFG_ERROR;
     }
     m_is_configured.store( true );    
-    PRINTF( GRN, "Configuration is accepted.\n" );
+    INFO_LOG( GRN, "Configuration is accepted.\n" );
     return Result::ALL_GOOD;
 }
 
@@ -31,27 +52,47 @@ Result Client::start()
 {
     if( ! m_is_configured.load() )
     {
-        PRINT_ERR( "Server has no configuration.\n" );
+        ERROR_LOG( "Server has no configuration.\n" );
         return Result::CFG_ERROR;
     }
-    ::std::cout << "Starting Unix client. Server address : " 
-                << m_config.m_address <<::std::endl;
+    INFO_LOG( GRN, "Starting Unix client. Server address : %s.\n", m_config.m_address.c_str() );
     
+    m_end_tag = "</" + m_config.m_delimiter + ">";
     m_socket_uptr = ::std::make_unique< Socket >(m_io_service);
+    /* Connect would open the socket with the default stream protocol */
+    m_socket_uptr->open( Protocol( m_config.m_transport ) );
+    m_out_queue.measure( m_metrics );
+    m_out_queue.limit( m_config.m_watermarks, [ this ]( bool is_high )
+        {
+            if( m_config.m_watermark_cb )
+            {
+                m_config.m_watermark_cb( m_config.m_client_id, is_high );
+            }
+        } );
+    m_out_queue.split( m_config.m_chunk_size );
+    if( m_config.m_shm_size != 0 )
+    {
+        m_shm_uptr = ::std::make_unique< ShmChannel >( m_io_service,
+            ::std::bind( &Client::deliver, this, ::std::placeholders::_1 ),
+            ::std::bind( &Client::flushBatch, this ),
+            ::std::bind( &Client::notifySent, this, ::std::placeholders::_1 ) );
+        m_shm_uptr->limit( m_config.m_watermarks.m_high_bytes );
+        m_shm_uptr->measure( m_metrics );
+    }
     m_endpoint_uptr = ::std::make_unique< EndPoint >( m_config.m_address );
     connect(m_config.m_con_type);
     auto work = [&](){ m_io_service.run(); };
 #ifdef THREAD_IMPLEMENTATION
     m_worker = ::std::move( ::std::thread( work ) );
 #else
-    m_future = ::std::async( work );
+    m_future = ::std::async( ::std::launch::async, work );
 #endif
     return Result::ALL_GOOD;
 }
 
-#define CON_RETRY_DELAY ::std::chrono::milliseconds( 500 )
 void Client::connect( ConnectType conType )
 {
+    m_connect_at = StatsClock::now();
     switch( conType )
     {
         case ConnectType::ASYNC_CONNECT :
@@ -59,38 +100,35 @@ void Client::connect( ConnectType conType )
             m_socket_uptr->async_connect( * m_endpoint_uptr, 
             [&] ( const ::boost::system::error_code& error )
             {
-                if( !error )
+                if( error == ::boost::asio::error::operation_aborted )
                 {
-                    PRINTF( GRN, "Successfully connected to the server '%s'.\n", 
-                            m_endpoint_uptr->path().c_str() );
-                    identify();
-                    m_is_connected.store( true ); //let send after identification
-                    this->recv();
-                } else {
-                    PRINT_ERR( "Can't connect to the server '%s'.\n",
-                        m_endpoint_uptr->path().c_str() );
+                    return; /* Client is destroyed */
                 }
+                if( error )
+                {
+                    ERROR_LOG( "Can't connect to the server '%s' : %s.\n",
+                        m_endpoint_uptr->path().c_str(), error.message().c_str() );
+                    m_connect_failures.fetch_add( 1, ::std::memory_order_relaxed );
+                    retry();
+                    return;
+                }
+                connected();
             } );
             break;
         } //end ASYNC_CONNECT
         case ConnectType::SYNC_CONNECT : //Usually before connection client is useless
         {
-            try {
-                m_socket_uptr->connect( * m_endpoint_uptr );
-                PRINTF( GRN, "Successfully connected to the server '%s'.\n", 
-                        m_endpoint_uptr->path().c_str() );
-                identify();
-                m_is_connected.store( true );
-                this->recv();
-            } catch( const ::std::exception& e ) {
-                PRINT_ERR( "%s.\n", e.what() );
-            }
-            if( ! m_is_connected.load() ) //try again
+            ErrCode error;
+            m_socket_uptr->connect( * m_endpoint_uptr, error );
+            if( error )
             {
-                /* Delay */
-                ::std::this_thread::sleep_for( CON_RETRY_DELAY );
-                this->connect( ConnectType::SYNC_CONNECT );
+                ERROR_LOG( "Can't connect to the server '%s' : %s.\n",
+                    m_endpoint_uptr->path().c_str(), error.message().c_str() );
+                m_connect_failures.fetch_add( 1, ::std::memory_order_relaxed );
+                retry();
+                break;
             }
+            connected();
             break;
         } //end SYNC_CONNECT
         default :
@@ -100,62 +138,402 @@ void Client::connect( ConnectType conType )
     } //end switch
 }
 
+void Client::connected()
+{
+    DEBUG_LOG( GRN, "Successfully connected to the server '%s'.\n", 
+            m_endpoint_uptr->path().c_str() );
+    m_frames_at_connect = m_metrics.m_frames_in.load( ::std::memory_order_relaxed );
+    bool is_reconnect = ( m_connects.fetch_add( 1, ::std::memory_order_relaxed ) != 0 );
+    m_out_queue.start( * m_socket_uptr, m_config.m_transport, m_config.m_framing,
+        [ this ]( ::std::size_t bytes_transferred )
+        {
+            notifySent( bytes_transferred );
+            TRACE_LOG( GRN, "%lu bytes is sent.\n", bytes_transferred );
+        },
+        ::std::bind( &Client::writeError, this, ::std::placeholders::_1 ) );
+    identify();
+    /* Server doesn't confirm it, so identification ends when its frame is queued */
+    m_metrics.m_identification_us.store( static_cast< ::std::uint64_t >( 
+        ::std::chrono::duration_cast< ::std::chrono::microseconds >( 
+            StatsClock::now() - m_connect_at ).count() ), ::std::memory_order_relaxed );
+    if( ! is_reconnect ) /* Closed channel isn't reused, data goes through the socket */
+    {
+        offerShm();
+    }
+    {
+        /* Frames sent meanwhile wait for the lock and go after these ones */
+        ::std::lock_guard< ::std::mutex > lock( m_offline_mtx );
+        ::std::size_t dropped = 0;
+        for( OutFrame& frame : m_offline )
+        {
+            dropped += ( m_out_queue.push( ::std::move( frame ) ) != Result::ALL_GOOD ) ? 1 : 0;
+        }
+        if( dropped != 0 )
+        {
+            ERROR_LOG( "%lu frames sent while offline are dropped.\n", dropped );
+        }
+        m_offline.clear();
+        m_offline_size = 0;
+        m_is_connected.store( true ); //let send after identification
+    }
+    this->recv();
+}
+
+void Client::lost( const ErrCode& error )
+{
+    if( ! m_is_connected.exchange( false ) )
+    {
+        return; /* Handlers of the connection, that is already closed */
+    }
+    ErrCode ignored;
+    m_socket_uptr->shutdown( Socket::shutdown_both, ignored );
+    m_socket_uptr->close( ignored );
+    if( m_shm_uptr )
+    {
+        m_shm_uptr->close(); /* Server's end of the memory is gone */
+    }
+    m_read_buf.clear(); /* Partial frame of the old connection */
+    m_fds.clear();
+    /* Connection, that carried nothing from the server and dropped soon, is the failed attempt :
+     * client rejected at identification gives up after 'm_max_attempts' */
+    if( m_metrics.m_frames_in.load( ::std::memory_order_relaxed ) != m_frames_at_connect ||
+        StatsClock::now() - m_connect_at >= m_config.m_backoff.m_max_delay )
+    {
+        m_attempts = 0;
+    }
+    if( m_config.m_error_cb )
+    {
+        m_config.m_error_cb( m_config.m_client_id, error.message() );
+    }
+    retry();
+}
+
+void Client::retry()
+{
+    ErrCode ignored;
+    m_socket_uptr->close( ignored ); /* Socket of the failed connect can't be reused */
+    if( ! m_config.m_reconnect )
+    {
+        return;
+    }
+    if( m_config.m_backoff.m_max_attempts != 0 && 
+        m_attempts >= m_config.m_backoff.m_max_attempts )
+    {
+        ERROR_LOG( "Server '%s' isn't reachable, client gives up.\n",
+            m_endpoint_uptr->path().c_str() );
+        {
+            ::std::lock_guard< ::std::mutex > lock( m_offline_mtx );
+            m_offline.clear();
+            m_offline_size = 0;
+        }
+        if( m_config.m_error_cb )
+        {
+            m_config.m_error_cb( m_config.m_client_id, "Server isn't reachable" );
+        }
+        return;
+    }
+    ::std::chrono::milliseconds delay = backoff();
+    m_attempts++;
+    DEBUG_LOG( YEL, "Connection attempt #%lu in %ld ms.\n", m_attempts, delay.count() );
+    m_retry_timer.expires_after( delay );
+    m_retry_timer.async_wait( [ & ]( const ErrCode& error )
+    {
+        if( error )
+        {
+            return; /* Client is destroyed */
+        }
+        ErrCode open_error;
+        m_socket_uptr->open( Protocol( m_config.m_transport ), open_error );
+        if( open_error )
+        {
+            ERROR_LOG( "Can't open socket : %s.\n", open_error.message().c_str() );
+            retry();
+            return;
+        }
+        connect( ConnectType::ASYNC_CONNECT );
+    } );
+}
+
+::std::chrono::milliseconds Client::backoff()
+{
+    const Backoff& backoff = m_config.m_backoff;
+    /* Doubling stops at 'm_max_delay' long before the shift could overflow */
+    ::std::chrono::milliseconds delay = ::std::min( backoff.m_max_delay,
+        backoff.m_min_delay * ( 1l << ::std::min< ::std::size_t >( m_attempts, 20 ) ) );
+    ::std::uniform_real_distribution< double > jitter( 0.0, backoff.m_jitter );
+    return ::std::chrono::milliseconds( static_cast< ::std::chrono::milliseconds::rep >( 
+        delay.count() * ( 1.0 - jitter( m_random ) ) ) );
+}
+
+Result Client::sendChunks( Chunks&& chunks )
+{
+    return push( makeFrame( ::std::move( chunks ) ) );
+}
+
+Result Client::push( OutFrame&& frame )
+{
+    if( ! m_is_connected.load() )
+    {
+        return sendOffline( ::std::move( frame ) );
+    }
+    Result result = m_shm_uptr ? m_shm_uptr->send( ::std::move( frame ), m_out_queue ) :
+        m_out_queue.push( ::std::move( frame ) );
+    return ( result == Result::ALL_GOOD ) ? Result::SEND_SUCCESS : result;
+}
+
+Result Client::sendOffline( OutFrame&& frame )
+{
+    {
+        ::std::lock_guard< ::std::mutex > lock( m_offline_mtx );
+        if( ! m_is_connected.load() )
+        {
+            if( m_offline_size + frame.size() > m_config.m_offline_bytes )
+            {
+                return ( m_config.m_offline_bytes != 0 ) ? 
+                    Result::WOULD_BLOCK : Result::SEND_ERROR;
+            }
+            m_offline_size += frame.size();
+            m_offline.emplace_back( ::std::move( frame ) );
+            return Result::SEND_SUCCESS;
+        }
+    }
+    /* Connection is restored meanwhile, offline frames are already queued */
+    Result result = m_out_queue.push( ::std::move( frame ) );
+    return ( result == Result::ALL_GOOD ) ? Result::SEND_SUCCESS : result;
+}
+
 void Client::identify()
 {
-    Tree xml_tree;
-    xml_tree.put( m_config.m_id_key, m_config.m_client_id );
-    ::std::ostringstream xml_stream;
-    PropTree::write_xml( xml_stream, xml_tree );
-    PRINTF( YEL, "Sending identification : %s.\n", xml_stream.str().c_str() );
-    send( xml_stream.str() );
+    ::std::uint16_t caps = 0;
+    caps |= m_config.m_pass_fds ? CAP_FDS : 0;
+    caps |= ( m_config.m_shm_size != 0 ) ? CAP_SHM : 0;
+    caps |= m_config.m_group ? CAP_GROUP : 0;
+    caps |= ( m_config.m_framing == Framing::LENGTH_PREFIX ) ? CAP_CHUNKS : 0;
+    DEBUG_LOG( YEL, "Sending identification : %s.\n", m_config.m_client_id.c_str() );
+    /* Not through 'send' : it waits for the end of identification */
+    m_out_queue.push( makeIdentification( m_config.m_handshake, m_config.m_framing, 
+        m_config.m_id_key, m_config.m_client_id, caps ) );
+}
 
+void Client::offerShm()
+{
+    if( ! m_shm_uptr )
+    {
+        return;
+    }
+    Fds fds;
+    ::std::uint64_t capacity = m_config.m_shm_size;
+    if( m_shm_uptr->create( capacity, fds ) != Result::ALL_GOOD )
+    {
+        ERROR_LOG( "Shared memory isn't available, socket is used.\n" );
+        return;
+    }
+    FrameHeader header = makeHeader( sizeof( capacity ), FrameType::SHM_OFFER );
+    header.m_flags |= FLAG_FDS | ( fds.size() << 8 );
+    m_out_queue.push( OutFrame{ header, makeShared( 
+        Buffer( reinterpret_cast< const char * >( & capacity ), sizeof( capacity ) ) ),
+        ::std::move( fds ) } );
 }
 
 void Client::recv()
 {
-    /* Usage of static buffer is abandoned in favour of multithread implementation. 
-     * Each recv handler will have its own buffer */
-    // m_read_buf.clear();
-    // m_read_buf.reserve( READ_BUF_SIZE );
+    if( m_config.m_pass_fds || m_config.m_transport == Transport::SEQPACKET )
+    { /* Plain read drops ancillary data and can't detect truncated packets,
+       * so 'recvmsg' is used when socket is ready */
+        m_socket_uptr->async_wait( Socket::wait_read,
+        [ & ] ( const ErrCode& error )
+        {
+            ErrCode read_error = error;
+            ::std::size_t bytes_transferred = 0;
+            if( ! read_error )
+            {
+                bytes_transferred = recvWithFds( * m_socket_uptr, m_read_buf.prepare( 
+                    ::std::max< ::std::size_t >( READ_BUF_SIZE, m_config.m_max_packet ) ), 
+                    m_fds, read_error );
+            }
+            if( read_error == ::boost::asio::error::would_block ||
+                read_error == ::boost::asio::error::try_again )
+            {
+                this->recv();
+                return;
+            }
+            if( read_error )
+            {
+                readError( read_error );
+                return;
+            }
+            received( bytes_transferred );
+        } ); //end async_wait
+        return;
+    }
+    /* Only one read is in flight, so the buffer is persistent. */
+    m_socket_uptr->async_read_some( m_read_buf.prepare( READ_BUF_SIZE ),
+    [ & ] ( const ErrCode& error, ::std::size_t bytes_transferred )
+    {
+        if( error )
+        {
+            readError( error );
+            return;
+        }
+        received( bytes_transferred );
+    } ); //end async_read_some
+}
 
-    BufferShPtr read_buf_shptr = ::std::make_shared< Buffer >();
-    read_buf_shptr->reserve( READ_BUF_SIZE );
+void Client::received( ::std::size_t bytes_transferred )
+{
+    m_read_buf.commit( bytes_transferred );
 
-    ::boost::asio::async_read_until( * m_socket_uptr,
-    ::boost::asio::dynamic_buffer( * read_buf_shptr ),
-    ::std::string{ "</" + m_config.m_delimiter + ">" },
-    [ & , read_buf_shptr ] ( const ErrCode& error, 
-    ::std::size_t bytes_transferred ) //mutable
+    /* Deliver every complete frame, the rest waits for the next read */
+    Frame frame;
+    while( m_read_buf.next( m_config.m_framing, m_end_tag, frame ) )
     {
-        if( error )
+        deliver( frame );
+    }
+    flushBatch();
+    this->recv();
+}
+
+void Client::flushBatch()
+{
+    if( m_batch_len != 0 )
+    {
+        m_batch.resize( m_batch_len );
+        m_config.m_recv_batch_cb( m_config.m_client_id, m_batch );
+        m_batch_len = 0;
+    }
+}
+
+void Client::notifySent( ::std::size_t bytes )
+{
+    Metrics::add( m_metrics.m_frames_out );
+    Metrics::add( m_metrics.m_bytes_out, bytes );
+    m_config.m_send_cb( m_config.m_client_id, bytes );
+}
+
+void Client::deliver( const Frame& frame )
+{
+    Metrics::add( m_metrics.m_frames_in );
+    Metrics::add( m_metrics.m_bytes_in, frame.m_size );
+    /* Descriptors arrive in the same order as frames they belong to */
+    for( ::std::size_t idx = fdsNumber( frame.m_header ); idx != 0 && ! m_fds.empty(); idx-- )
+    {
+        m_frame_fds.emplace_back( ::std::move( m_fds.front() ) );
+        m_fds.pop_front();
+    }
+    if( m_config.m_framing == Framing::LENGTH_PREFIX && control( frame ) )
+    { /* Service frame, nothing for the user */ }
+    else if( ! m_frame_fds.empty() && m_config.m_recv_fds_cb )
+    {
+        m_frame_buf.assign( frame.m_data, frame.m_size );
+        m_config.m_recv_fds_cb( m_config.m_client_id, m_frame_buf, m_frame_fds );
+    }
+    else if( m_config.m_recv_view_cb )
+    {
+        m_config.m_recv_view_cb( m_config.m_client_id, frame );
+    }
+    else if( m_config.m_recv_batch_cb ) 
+    {
+        if( m_batch_len == m_batch.size() )
+        {
+            m_batch.emplace_back();
+        }
+        /* Strings keep their capacity from previous batches */
+        m_batch[ m_batch_len++ ].assign( frame.m_data, frame.m_size );
+    }
+    else
+    {
+        m_frame_buf.assign( frame.m_data, frame.m_size );
+        m_config.m_recv_cb( m_config.m_client_id, m_frame_buf );
+    }
+    m_frame_fds.clear(); /* Descriptors not taken by user are closed */
+}
+
+bool Client::control( const Frame& frame )
+{
+    switch( static_cast< FrameType >( frame.m_header.m_type ) )
+    {
+        case FrameType::SHM_ACCEPT :
         {
-            PRINT_ERR( "Error when reading : %s\n", error.message().c_str() );
-            if( m_socket_uptr->is_open() )
+            if( m_shm_uptr && m_shm_uptr->isOpen() )
             {
-                m_socket_uptr->shutdown( Socket::shutdown_receive );
+                /* Everything server sent before 'SHM_ACCEPT' is already delivered */
+                m_shm_uptr->startReceiving();
+                m_shm_uptr->startSending( 
+                    OutFrame{ makeHeader( 0, FrameType::SHM_START ), makeShared( Buffer{} ) },
+                    m_out_queue );
+                DEBUG_LOG( GRN, "Shared memory with server is opened.\n" );
             }
-            return;
+            return true;
+        }
+        case FrameType::SHM_REJECT :
+        {
+            ERROR_LOG( "Server rejected shared memory, socket is used.\n" );
+            return true;
+        }
+        default :
+        {
+            return false;
         }
-        m_config.m_recv_cb( m_config.m_client_id, * read_buf_shptr );
-        m_read_buf.clear();
-        this->recv();
-    } ); //end async_read_until
+    } //end switch
 }
 
-Client::~Client()
+void Client::readError( const ErrCode& error )
+{
+    if( error != ::boost::asio::error::operation_aborted ) /* Closed by 'lost' */
+    {
+        Metrics::add( m_metrics.m_read_errors );
+        ERROR_LOG( "Error when reading : %s\n", error.message().c_str() );
+    }
+    lost( error );
+}
+
+void Client::writeError( const ErrCode& error )
+{
+    if( error != ::boost::asio::error::operation_aborted ) /* Closed by 'lost' */
+    {
+        Metrics::add( m_metrics.m_write_errors );
+        ERROR_LOG( "Error when writing : %s\n", error.message().c_str() );
+    }
+    lost( error );
+}
+
+void Client::stop()
 {
     m_io_service.stop();
 #ifdef THREAD_IMPLEMENTATION
-    m_worker.join();
+    if( m_worker.joinable() )
+    {
+        m_worker.join();
+    }
 #else
-    m_future.get();
+    if( m_future.valid() )
+    {
+        m_future.get();
+    }
 #endif
-    if( m_socket_uptr->is_open() )
+}
+
+Client::Stats Client::stats()
+{
+    Stats stats;
+    stats.m_client_id = m_config.m_client_id;
+    m_metrics.fill( stats );
+    m_out_queue.depth( stats.m_queued_bytes, stats.m_queued_frames );
+    stats.m_connects = m_connects.load( ::std::memory_order_relaxed );
+    stats.m_connect_failures = m_connect_failures.load( ::std::memory_order_relaxed );
+    return stats;
+}
+
+Client::~Client()
+{
+    stop();
+    if( m_socket_uptr && m_socket_uptr->is_open() )
     {
-        m_socket_uptr->shutdown( Socket::shutdown_both );
-        m_socket_uptr->close();
+        ErrCode ignored; /* Server may be gone already */
+        m_socket_uptr->shutdown( Socket::shutdown_both, ignored );
+        m_socket_uptr->close( ignored );
     }
-    PRINTF( YEL, "Client '%s' destroyed.\n", m_config.m_client_id.c_str() );
+    DEBUG_LOG( YEL, "Client '%s' destroyed.\n", m_config.m_client_id.c_str() );
 }
 
 /* EOF */
\ No newline at end of file
@@ -7,28 +7,43 @@ namespace UnixSocket
 {
 
 template< typename Data >
-void Client::send( Data&& data )
+Result Client::send( Data&& data )
 {
-    ::boost::asio::async_write( * m_socket_uptr,
-        ::boost::asio::buffer(
-            ::std::forward<Data>(data).data(), 
-            ::std::forward<Data>(data).size() ),
-        [&]( const boost::system::error_code& error, ::std::size_t bytes_transferred )
-        {
-            if ( !error ) /* All good */
-            {
-                m_config.m_send_cb( m_config.m_client_id ,bytes_transferred );
-                PRINTF( GRN, "%lu bytes is sent.\n", bytes_transferred );
-            }
-            else
-            {
-                PRINT_ERR( "Error when writing : %s\n", error.message().c_str() );
-                if( m_socket_uptr->is_open() )
-                {
-                    m_socket_uptr->shutdown( Socket::shutdown_receive );
-                }
-            }
-        } );
+    return send( Priority::NORMAL, ::std::forward<Data>(data) );
+}
+
+template< typename Data >
+Result Client::send( Priority priority, Data&& data )
+{
+    ConstBufferShPtr payload = makeShared( ::std::forward<Data>(data) );
+    OutFrame frame{ makeHeader( payload->size() ), ::std::move( payload ) };
+    frame.m_priority = priority;
+    return push( ::std::move( frame ) );
+}
+
+template< typename Data >
+Result Client::sendFds( Data&& data, const ::std::vector< int >& fds )
+{
+    if( m_config.m_framing != Framing::LENGTH_PREFIX )
+    {
+        ERROR_LOG( "Descriptors can be passed only with length prefixed framing.\n" );
+        return Result::CFG_ERROR;
+    }
+    if( ! m_is_connected.load() )
+    {
+        return Result::SEND_ERROR; /* Descriptors aren't kept offline */
+    }
+    Fds dup_fds;
+    if( dupFds( fds, dup_fds ) != Result::ALL_GOOD )
+    {
+        return Result::SEND_ERROR;
+    }
+    ConstBufferShPtr payload = makeShared( ::std::forward<Data>(data) );
+    FrameHeader header = makeHeader( payload->size() );
+    header.m_flags |= FLAG_FDS | ( dup_fds.size() << 8 );
+    Result result = m_out_queue.push( 
+        OutFrame{ header, ::std::move( payload ), ::std::move( dup_fds ) } );
+    return ( result == Result::ALL_GOOD ) ? Result::SEND_SUCCESS : result;
 }
 
 }
@@ -0,0 +1,50 @@
+#include "UnixSocket.h"
+
+using namespace UnixSocket;
+
+/*------------------*/
+/*--- ClientPool ---*/
+/*------------------*/
+Result ClientPool::setConfig( Config&& cfg )
+{
+    m_config = cfg;
+    if( m_config.m_connections == 0 )
+    {
+        ERROR_LOG( "Pool needs at least one connection.\n" );
+        return Result::CFG_ERROR;
+    }
+    m_config.m_client.m_group = true;
+    m_clients.clear();
+    for( ::std::size_t idx = 0; idx < m_config.m_connections; idx++ )
+    {
+        m_clients.emplace_back( ::std::make_unique< Client >() );
+        Client::Config client_config = m_config.m_client;
+        if( m_clients.back()->setConfig( ::std::move( client_config ) ) != Result::ALL_GOOD )
+        {
+            m_clients.clear();
+            return Result::CFG_ERROR;
+        }
+    }
+    m_is_configured.store( true );
+    INFO_LOG( GRN, "Pool of %lu connections is configured.\n", m_config.m_connections );
+    return Result::ALL_GOOD;
+}
+
+Result ClientPool::start()
+{
+    if( ! m_is_configured.load() )
+    {
+        ERROR_LOG( "Pool has no configuration.\n" );
+        return Result::CFG_ERROR;
+    }
+    for( auto& client : m_clients )
+    {
+        if( client->start() != Result::ALL_GOOD )
+        {
+            return Result::CFG_ERROR;
+        }
+    }
+    return Result::ALL_GOOD;
+}
+
+/* EOF */
\ No newline at end of file
@@ -0,0 +1,39 @@
+#ifndef UNIX_SOCKET_CLIENT_POOL_HPP
+#define UNIX_SOCKET_CLIENT_POOL_HPP
+
+#include "UnixSocket.h"
+
+namespace UnixSocket
+{
+
+template< typename Data >
+Result ClientPool::send( Data&& data )
+{
+    /* Wrapped once, retries share the payload */
+    ConstBufferShPtr payload = makeShared( ::std::forward<Data>(data) );
+    ::std::size_t first = m_next.fetch_add( 1 );
+    Result result = Result::SEND_ERROR;
+    for( ::std::size_t idx = 0; idx < m_clients.size(); idx++ )
+    {
+        result = m_clients[ ( first + idx ) % m_clients.size() ]->send( payload );
+        if( result == Result::SEND_SUCCESS )
+        {
+            break;
+        }
+    }
+    return result;
+}
+
+template< typename Data >
+Result ClientPool::send( OrderKey key, Data&& data )
+{
+    if( m_clients.empty() )
+    {
+        return Result::SEND_ERROR;
+    }
+    return m_clients[ key % m_clients.size() ]->send( ::std::forward<Data>(data) );
+}
+
+}
+
+#endif /* UNIX_SOCKET_CLIENT_POOL_HPP */
\ No newline at end of file
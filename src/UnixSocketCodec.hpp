@@ -0,0 +1,90 @@
+#ifndef UNIX_SOCKET_CODEC_HPP
+#define UNIX_SOCKET_CODEC_HPP
+
+#include "UnixSocket.h"
+
+namespace UnixSocket
+{
+
+template< typename T >
+ConstBufferShPtr encodeMessage( const T& message )
+{
+    static_assert( IsMessage< T >::value, "Type has no 'MessageTag', register it with 'UNIX_SOCKET_MESSAGE'" );
+    MessageHeader header{ MessageTag< T >::value };
+    ::std::size_t size = Codec< T >::size( message );
+    BufferShPtr payload = ::std::make_shared< Buffer >( sizeof( header ) + size, '\0' );
+    ::std::memcpy( & ( * payload )[ 0 ], & header, sizeof( header ) );
+    Codec< T >::encode( message, & ( * payload )[ sizeof( header ) ] );
+    return payload;
+}
+
+template< typename T >
+bool decodeMessage( const Frame& frame, T& message )
+{
+    MessageHeader header;
+    if( frame.m_size < sizeof( header ) ) { return false; }
+    ::std::memcpy( & header, frame.m_data, sizeof( header ) );
+    if( header.m_type != MessageTag< T >::value ) { return false; }
+    return Codec< T >::decode( frame.m_data + sizeof( header ), frame.m_size - sizeof( header ), message );
+}
+
+template< typename Handler, typename... Messages >
+constexpr bool Dispatcher< Handler, Messages... >::hasUniqueTags()
+{
+    constexpr MessageType tags[] = { MessageTag< Messages >::value... };
+    for( ::std::size_t i = 0; i < sizeof...( Messages ); ++i )
+    {
+        for( ::std::size_t j = i + 1; j < sizeof...( Messages ); ++j )
+        {
+            if( tags[ i ] == tags[ j ] ) { return false; }
+        }
+    }
+    return true;
+}
+
+template< typename Handler, typename... Messages >
+bool Dispatcher< Handler, Messages... >::operator()( const ClientId& client_id, const Frame& frame )
+{
+    static_assert( hasUniqueTags(), "Message types of one dispatcher should have different tags" );
+
+    MessageHeader header;
+    if( frame.m_size < sizeof( header ) )
+    {
+        ERROR_LOG( "Message from client '%s' is shorter than its header.\n", client_id.c_str() );
+        return false;
+    }
+    ::std::memcpy( & header, frame.m_data, sizeof( header ) );
+    const char * body = frame.m_data + sizeof( header );
+    ::std::size_t size = frame.m_size - sizeof( header );
+
+    /* Unrolled into the chain of comparisons with constants, no tables and no virtual calls */
+    bool is_valid = false;
+    bool is_known = ( ( header.m_type == MessageTag< Messages >::value &&
+        ( is_valid = deliver< Messages >( client_id, body, size ), true ) ) || ... );
+    if( ! is_known )
+    {
+        ERROR_LOG( "Message of unknown type %u from client '%s'.\n", 
+            static_cast< unsigned >( header.m_type ), client_id.c_str() );
+    }
+    else if( ! is_valid )
+    {
+        ERROR_LOG( "Malformed message of type %u from client '%s'.\n", 
+            static_cast< unsigned >( header.m_type ), client_id.c_str() );
+    }
+    return is_valid;
+}
+
+template< typename Handler, typename... Messages >
+template< typename T >
+bool Dispatcher< Handler, Messages... >::deliver( const ClientId& client_id, 
+    const char * body, ::std::size_t size )
+{
+    T message{};
+    if( ! Codec< T >::decode( body, size, message ) ) { return false; }
+    m_handler( client_id, static_cast< const T& >( message ) );
+    return true;
+}
+
+}
+
+#endif /* UNIX_SOCKET_CODEC_HPP */
\ No newline at end of file
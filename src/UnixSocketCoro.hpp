@@ -0,0 +1,244 @@
+#ifndef UNIX_SOCKET_CORO_HPP
+#define UNIX_SOCKET_CORO_HPP
+
+#include "UnixSocket.h"
+
+#ifdef BOOST_ASIO_HAS_CO_AWAIT
+
+namespace UnixSocket
+{
+
+/*-----------------*/
+/*--- CoSession ---*/
+/*-----------------*/
+inline CoSession::CoSession( Socket&& socket, const CoConfig& config, bool is_identified )
+    : m_socket( ::std::move( socket ) ),
+    m_config( config ),
+    m_end_tag( "</" + config.m_delimiter + ">" ),
+    m_id_tag( "</" + config.m_id_key + ">" ),
+    m_is_identified( is_identified )
+{ }
+
+inline Awaitable< Result > CoSession::recv( Frame& frame )
+{
+    if( ! m_is_identified )
+    {
+        Result result = co_await identify();
+        if( result != Result::ID_SUCCESS )
+        {
+            co_return result;
+        }
+    }
+    while( true )
+    {
+        Result result = co_await next( frame, m_config.m_framing, m_end_tag );
+        if( result != Result::ALL_GOOD ||
+            m_config.m_framing != Framing::LENGTH_PREFIX ||
+            frame.m_header.m_type == static_cast< ::std::uint16_t >( FrameType::DATA ) )
+        {
+            co_return result;
+        }
+        /* Service frames of 'Client' ( shared memory offer ) aren't supported */
+    }
+}
+
+template< typename Data >
+Awaitable< Result > CoSession::send( const Data& data )
+{
+    return write( makeHeader( data.size() ), ::boost::asio::buffer( data.data(), data.size() ) );
+}
+
+inline Awaitable< Result > CoSession::identify()
+{
+    Frame frame;
+    /* Binary handshake is length prefixed whatever the framing is */
+    Framing id_framing = ( m_config.m_handshake == Handshake::BINARY ) ?
+        Framing::LENGTH_PREFIX : m_config.m_framing;
+    Result result = co_await next( frame, id_framing, m_id_tag );
+    if( result != Result::ALL_GOOD )
+    {
+        co_return result;
+    }
+    ::std::uint16_t caps = 0;
+    m_client_id = parseIdentification( frame, m_config.m_handshake, m_config.m_id_key, caps );
+    if( m_client_id.empty() )
+    {
+        ErrCode ignored;
+        m_socket.close( ignored );
+        co_return Result::ID_FAILURE;
+    }
+    m_is_identified = true;
+    DEBUG_LOG( GRN, "Client '%s' successfully identified.\n", m_client_id.c_str() );
+    co_return Result::ID_SUCCESS;
+}
+
+inline Awaitable< Result > CoSession::next( Frame& frame, Framing framing, 
+    const ::std::string& end_tag )
+{
+    while( ! m_read_buf.next( framing, end_tag, frame ) )
+    {
+        ErrCode error;
+        ::std::size_t bytes_transferred = 0;
+        if( m_config.m_transport == Transport::SEQPACKET )
+        { /* Plain read can't detect truncated packets */
+            co_await m_socket.async_wait( Socket::wait_read,
+                ::boost::asio::redirect_error( ::boost::asio::use_awaitable, error ) );
+            if( ! error )
+            {
+                bytes_transferred = recvWithFds( m_socket, m_read_buf.prepare( 
+                    ::std::max< ::std::size_t >( READ_BUF_SIZE, m_config.m_max_packet ) ), 
+                    m_fds, error );
+                m_fds.clear();
+            }
+            if( error == ::boost::asio::error::would_block ||
+                error == ::boost::asio::error::try_again )
+            {
+                continue;
+            }
+        }
+        else
+        {
+            bytes_transferred = co_await m_socket.async_read_some( 
+                m_read_buf.prepare( READ_BUF_SIZE ),
+                ::boost::asio::redirect_error( ::boost::asio::use_awaitable, error ) );
+        }
+        if( error )
+        {
+            ERROR_LOG( "Error when reading : %s\n", error.message().c_str() );
+            co_return Result::RECV_ERROR;
+        }
+        m_read_buf.commit( bytes_transferred );
+    }
+    co_return Result::ALL_GOOD;
+}
+
+/* One gathered write, one packet for 'Transport::SEQPACKET' */
+inline Awaitable< Result > CoSession::write( FrameHeader header, 
+    ::boost::asio::const_buffer payload )
+{
+    ::std::array< ::boost::asio::const_buffer, 2 > buffers{
+        ::boost::asio::buffer( & header, 
+            ( m_config.m_framing == Framing::LENGTH_PREFIX ) ? sizeof( header ) : 0 ),
+        payload };
+    ErrCode error;
+    co_await ::boost::asio::async_write( m_socket, buffers,
+        ::boost::asio::redirect_error( ::boost::asio::use_awaitable, error ) );
+    if( error )
+    {
+        ERROR_LOG( "Error when writing : %s\n", error.message().c_str() );
+        co_return Result::SEND_ERROR;
+    }
+    co_return Result::SEND_SUCCESS;
+}
+
+/*----------------*/
+/*--- CoServer ---*/
+/*----------------*/
+inline Result CoServer::setConfig( CoConfig&& cfg )
+{
+    m_config = cfg;
+    ERR_CHECK( m_config.m_address,      "file name" );
+    if( m_config.m_handshake == Handshake::XML )
+    {
+        ERR_CHECK( m_config.m_id_key,       "identification");
+    }
+    if( m_config.m_framing == Framing::DELIMITER )
+    {
+        ERR_CHECK( m_config.m_delimiter,    "delimiter");
+    }
+    if( m_config.m_framing == Framing::PACKET && m_config.m_transport != Transport::SEQPACKET )
+    {
+        ERROR_LOG( "Packet framing needs seqpacket transport.\n" );
+        return Result::CFG_ERROR;
+    }
+    unlink( m_config.m_address.c_str() ); //prepare address upfront
+    return Result::ALL_GOOD;
+}
+
+inline Result CoServer::start( IoService& io_service )
+{
+    try {
+        m_acceptor_uptr = ::std::make_unique< Acceptor >( io_service );
+        m_acceptor_uptr->open( Protocol( m_config.m_transport ) );
+        m_acceptor_uptr->bind( EndPoint{ m_config.m_address } );
+        m_acceptor_uptr->listen();
+    } catch( const ::std::exception& e ) {
+        ERROR_LOG( "%s.\n", e.what() );
+        return Result::CFG_ERROR;
+    }
+    return Result::ALL_GOOD;
+}
+
+inline Awaitable< CoSessionUptr > CoServer::accept()
+{
+    ErrCode error;
+    Socket socket = co_await m_acceptor_uptr->async_accept(
+        ::boost::asio::redirect_error( ::boost::asio::use_awaitable, error ) );
+    if( error )
+    {
+        if( error != ::boost::asio::error::operation_aborted )
+        {
+            ERROR_LOG( "Error when accepting : %s\n", error.message().c_str() );
+        }
+        co_return nullptr;
+    }
+    co_return ::std::make_unique< CoSession >( ::std::move( socket ), m_config, false );
+}
+
+inline void CoServer::close()
+{
+    if( m_acceptor_uptr )
+    {
+        ErrCode ignored;
+        m_acceptor_uptr->close( ignored );
+    }
+}
+
+/*----------------*/
+/*--- CoClient ---*/
+/*----------------*/
+inline Result CoClient::setConfig( CoConfig&& cfg )
+{
+    m_config = cfg;
+    ERR_CHECK( m_config.m_address,     "file name" );
+    if( m_config.m_handshake == Handshake::XML )
+    {
+        ERR_CHECK( m_config.m_id_key,      "identification" );
+    }
+    if( m_config.m_framing == Framing::DELIMITER )
+    {
+        ERR_CHECK( m_config.m_delimiter,   "delimiter" );
+    }
+    ERR_CHECK( m_config.m_client_id,   "client name" );
+    m_end_tag = "</" + m_config.m_delimiter + ">";
+    m_client_id = m_config.m_client_id;
+    return Result::ALL_GOOD;
+}
+
+inline Awaitable< Result > CoClient::connect()
+{
+    ErrCode error;
+    m_socket.open( Protocol( m_config.m_transport ), error );
+    if( ! error )
+    {
+        co_await m_socket.async_connect( EndPoint{ m_config.m_address },
+            ::boost::asio::redirect_error( ::boost::asio::use_awaitable, error ) );
+    }
+    if( error )
+    {
+        ERROR_LOG( "Can't connect to the server '%s' : %s.\n", 
+            m_config.m_address.c_str(), error.message().c_str() );
+        co_return Result::NO_SUCH_ADDRESS;
+    }
+    OutFrame identification = makeIdentification( m_config.m_handshake, m_config.m_framing,
+        m_config.m_id_key, m_config.m_client_id, 0 );
+    Result result = co_await write( identification.m_header, ::boost::asio::buffer( 
+        identification.m_payload->data(), identification.m_payload->size() ) );
+    co_return ( result == Result::SEND_SUCCESS ) ? Result::ALL_GOOD : result;
+}
+
+}
+
+#endif /* BOOST_ASIO_HAS_CO_AWAIT */
+
+#endif /* UNIX_SOCKET_CORO_HPP */
\ No newline at end of file
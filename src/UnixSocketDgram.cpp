@@ -0,0 +1,234 @@
+#include "UnixSocket.h"
+
+#include <poll.h>
+
+using namespace UnixSocket;
+
+/*-------------------*/
+/*--- DgramServer ---*/
+/*-------------------*/
+Result DgramServer::setConfig( Config&& cfg )
+{
+    m_config = cfg;
+    ERR_CHECK( m_config.m_address, "file name" );
+    if( m_config.m_max_packet == 0 )
+    {
+        ERROR_LOG( "No maximal datagram size provided.\n" );
+        return Result::CFG_ERROR;
+    }
+    if( ! m_config.m_recv_cb )
+    {
+        ERROR_LOG( "No RECEIVE callback provided.\n" );
+        return Result::CFG_ERROR;
+    }
+    if( ! m_config.m_error_cb )
+    {
+        ERROR_LOG( "No ERROR callback provided.\n" );
+        return Result::CFG_ERROR;
+    }
+    unlink( m_config.m_address.c_str() ); //prepare address upfront
+    m_is_configured.store( true );
+    INFO_LOG( GRN, "Configuration is accepted.\n" );
+    return Result::ALL_GOOD;
+}
+
+Result DgramServer::start()
+{
+    if( ! m_is_configured.load() )
+    {
+        ERROR_LOG( "Server has no configuration.\n" );
+        return Result::CFG_ERROR;
+    }
+    INFO_LOG( GRN, "Starting Unix datagram server : %s.\n", m_config.m_address.c_str() );
+    try {
+        m_socket_uptr = ::std::make_unique< DgramSocket >( m_io_service,
+            DgramEndPoint{ m_config.m_address } );
+        /* Lets the queued datagrams be drained without going through the reactor */
+        m_socket_uptr->non_blocking( true );
+    } catch( const ::std::exception& e ) {
+        ERROR_LOG( "%s.\n", e.what() );
+        return Result::CFG_ERROR;
+    }
+    /* One extra byte tells the oversized datagram from the one of maximal size */
+    m_frame_buf.resize( m_config.m_max_packet + 1 );
+    recv();
+    auto work = [&](){ m_io_service.run(); };
+#ifdef THREAD_IMPLEMENTATION
+    m_worker = ::std::move( ::std::thread( work ) );
+#else
+    m_future = ::std::async( ::std::launch::async, work );
+#endif
+    return Result::ALL_GOOD;
+}
+
+void DgramServer::recv()
+{
+    m_socket_uptr->async_receive_from( ::boost::asio::buffer( m_frame_buf ), m_sender,
+    [ & ] ( const ErrCode& error, ::std::size_t bytes_transferred )
+    {
+        if( error == ::boost::asio::error::operation_aborted )
+        {
+            return; /* Server is destroyed */
+        }
+        if( error )
+        {
+            ERROR_LOG( "Error when reading : %s\n", error.message().c_str() );
+            m_config.m_error_cb( ClientId{}, error.message() );
+        }
+        else
+        {
+            received( bytes_transferred );
+        }
+        this->recv();
+    } ); //end async_receive_from
+}
+
+void DgramServer::received( ::std::size_t bytes_transferred )
+{
+    ErrCode error;
+    do { /* Everything already queued is taken in one wake up */
+        /* Bound sender : abstract address starts with '\0', 
+         * which isn't a part of the identifier. Unbound one has empty path. */
+        const ::std::string path = m_sender.path();
+        m_sender_id.assign( path, ( ! path.empty() && path[ 0 ] == '\0' ) ? 1 : 0 );
+        if( bytes_transferred > m_config.m_max_packet )
+        {
+            ERROR_LOG( "Datagram from '%s' is too big, dropped.\n", m_sender_id.c_str() );
+            m_config.m_error_cb( m_sender_id, "Datagram is too big" );
+        }
+        else
+        {
+            m_frame_buf.resize( bytes_transferred );
+            m_config.m_recv_cb( m_sender_id, m_frame_buf );
+            m_frame_buf.resize( m_config.m_max_packet + 1 ); //capacity is kept
+        }
+        bytes_transferred = m_socket_uptr->receive_from( 
+            ::boost::asio::buffer( m_frame_buf ), m_sender, 0, error );
+    } while( ! error );
+    if( error != ::boost::asio::error::would_block &&
+        error != ::boost::asio::error::try_again )
+    {
+        ERROR_LOG( "Error when reading : %s\n", error.message().c_str() );
+        m_config.m_error_cb( ClientId{}, error.message() );
+    }
+}
+
+DgramServer::~DgramServer()
+{
+    m_io_service.stop();
+#ifdef THREAD_IMPLEMENTATION
+    if( m_worker.joinable() )
+    {
+        m_worker.join();
+    }
+#else
+    if( m_future.valid() )
+    {
+        m_future.get();
+    }
+#endif
+    if( m_socket_uptr && m_socket_uptr->is_open() )
+    {
+        m_socket_uptr->close();
+    }
+    INFO_LOG( YEL, "Datagram server destroyed.\n" );
+}
+
+/*-------------------*/
+/*--- DgramClient ---*/
+/*-------------------*/
+Result DgramClient::setConfig( Config&& cfg )
+{
+    m_config = cfg;
+    ERR_CHECK( m_config.m_address,     "file name" );
+    ERR_CHECK( m_config.m_client_id,   "client name" );
+    m_is_configured.store( true );
+    INFO_LOG( GRN, "Configuration is accepted.\n" );
+    return Result::ALL_GOOD;
+}
+
+Result DgramClient::start()
+{
+    if( ! m_is_configured.load() )
+    {
+        ERROR_LOG( "Client has no configuration.\n" );
+        return Result::CFG_ERROR;
+    }
+    try {
+        /* Abstract address : nothing to clean up in the file system */
+        m_socket_uptr = ::std::make_unique< DgramSocket >( m_io_service,
+            DgramEndPoint{ ::std::string( 1, '\0' ) + m_config.m_client_id } );
+        m_socket_uptr->non_blocking( true );
+    } catch( const ::std::exception& e ) {
+        ERROR_LOG( "Can't bind client '%s' : %s.\n", m_config.m_client_id.c_str(), e.what() );
+        return Result::CFG_ERROR;
+    }
+    connect(); /* Server may appear later */
+    return Result::ALL_GOOD;
+}
+
+bool DgramClient::connect()
+{
+    ::std::lock_guard< ::std::mutex > lock( m_connect_mtx );
+    if( m_is_connected.load() )
+    {
+        return true;
+    }
+    ErrCode error;
+    m_socket_uptr->connect( DgramEndPoint{ m_config.m_address }, error );
+    m_is_connected.store( ! error );
+    return ! error;
+}
+
+Result DgramClient::sendBuffer( ::boost::asio::const_buffer buffer )
+{
+    if( ! m_socket_uptr )
+    {
+        return Result::CFG_ERROR;
+    }
+    if( ! m_is_connected.load() && ! connect() )
+    {
+        return Result::NO_SUCH_ADDRESS;
+    }
+    ErrCode error;
+    m_socket_uptr->send( ::boost::asio::buffer( buffer ), 0, error );
+    if( ( error == ::boost::asio::error::would_block || error == ::boost::asio::error::try_again ) &&
+        m_config.m_send_timeout.count() != 0 )
+    {
+        pollfd poll_fd{ m_socket_uptr->native_handle(), POLLOUT, 0 };
+        if( ::poll( & poll_fd, 1, m_config.m_send_timeout.count() ) > 0 )
+        {
+            m_socket_uptr->send( ::boost::asio::buffer( buffer ), 0, error );
+        }
+    }
+    if( ! error )
+    {
+        return Result::SEND_SUCCESS;
+    }
+    if( error == ::boost::asio::error::would_block ||
+        error == ::boost::asio::error::try_again )
+    {
+        return Result::SEND_ERROR; /* Server is busy, datagram is dropped */
+    }
+    if( error == ::boost::asio::error::connection_refused ||
+        error == ::boost::asio::error::not_connected )
+    { /* Server is restarted or gone, address is looked up again next time */
+        m_is_connected.store( false );
+    }
+    if( m_config.m_error_cb )
+    {
+        m_config.m_error_cb( m_config.m_client_id, error.message() );
+    }
+    return Result::SEND_ERROR;
+}
+
+DgramClient::~DgramClient()
+{
+    if( m_socket_uptr && m_socket_uptr->is_open() )
+    {
+        m_socket_uptr->close();
+    }
+    DEBUG_LOG( YEL, "Datagram client '%s' destroyed.\n", m_config.m_client_id.c_str() );
+}
+
+/* EOF */
\ No newline at end of file
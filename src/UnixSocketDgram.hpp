@@ -0,0 +1,18 @@
+#ifndef UNIX_SOCKET_DGRAM_HPP
+#define UNIX_SOCKET_DGRAM_HPP
+
+#include "UnixSocket.h"
+
+namespace UnixSocket
+{
+
+template< typename Data >
+Result DgramClient::send( Data&& data )
+{
+    /* Sent before return, so the data isn't copied */
+    return sendBuffer( ::boost::asio::buffer( data ) );
+}
+
+} //end namespace UnixSocket
+
+#endif /* UNIX_SOCKET_DGRAM_HPP */
\ No newline at end of file
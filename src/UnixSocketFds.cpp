@@ -0,0 +1,126 @@
+#include "UnixSocket.h"
+
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace UnixSocket;
+
+#define MAX_FDS 253 /* SCM_MAX_FD of the kernel */
+
+void Fd::reset( int fd )
+{
+    if( m_fd >= 0 )
+    {
+        ::close( m_fd );
+    }
+    m_fd = fd;
+}
+
+Result UnixSocket::dupFds( const ::std::vector< int >& fds, Fds& out )
+{
+    if( fds.size() > MAX_FDS )
+    {
+        ERROR_LOG( "Can't pass more than %d descriptors at once.\n", MAX_FDS );
+        return Result::SEND_ERROR;
+    }
+    for( int fd : fds )
+    {
+        int dup_fd = ::fcntl( fd, F_DUPFD_CLOEXEC, 0 );
+        if( dup_fd < 0 )
+        {
+            ERROR_LOG( "Can't duplicate descriptor %d : %s.\n", fd, strerror( errno ) );
+            out.clear();
+            return Result::SEND_ERROR;
+        }
+        out.emplace_back( dup_fd );
+    }
+    return Result::ALL_GOOD;
+}
+
+::std::size_t UnixSocket::sendWithFds( Socket& socket, 
+    const ::boost::asio::const_buffer * buffers, ::std::size_t buf_num,
+    const Fds& fds, ErrCode& error )
+{
+    ::std::array< iovec, 4 > iov;
+    buf_num = ::std::min( buf_num, iov.size() );
+    for( ::std::size_t idx = 0; idx < buf_num; idx++ )
+    {
+        iov[ idx ].iov_base = const_cast< void * >( buffers[ idx ].data() );
+        iov[ idx ].iov_len = buffers[ idx ].size();
+    }
+    alignas( cmsghdr ) char control[ CMSG_SPACE( sizeof( int ) * MAX_FDS ) ];
+    msghdr msg{};
+    msg.msg_iov = iov.data();
+    msg.msg_iovlen = buf_num;
+    msg.msg_control = control;
+    msg.msg_controllen = CMSG_SPACE( sizeof( int ) * fds.size() );
+    cmsghdr * cmsg = CMSG_FIRSTHDR( & msg );
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN( sizeof( int ) * fds.size() );
+    int * fd_ptr = reinterpret_cast< int * >( CMSG_DATA( cmsg ) );
+    for( const Fd& fd : fds )
+    {
+        * fd_ptr++ = fd.get();
+    }
+
+    ssize_t sent = ::sendmsg( socket.native_handle(), & msg, MSG_DONTWAIT | MSG_NOSIGNAL );
+    if( sent < 0 )
+    {
+        error = ErrCode( errno, ::boost::system::system_category() );
+        return 0;
+    }
+    error = ErrCode();
+    return static_cast< ::std::size_t >( sent );
+}
+
+::std::size_t UnixSocket::recvWithFds( Socket& socket, ::boost::asio::mutable_buffer buffer,
+    ::std::deque< Fd >& fds, ErrCode& error )
+{
+    iovec iov{ buffer.data(), buffer.size() };
+    alignas( cmsghdr ) char control[ CMSG_SPACE( sizeof( int ) * MAX_FDS ) ];
+    msghdr msg{};
+    msg.msg_iov = & iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof( control );
+
+    ssize_t received = ::recvmsg( socket.native_handle(), & msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC );
+    if( received < 0 )
+    {
+        error = ErrCode( errno, ::boost::system::system_category() );
+        return 0;
+    }
+    if( received == 0 )
+    {
+        error = ::boost::asio::error::eof;
+        return 0;
+    }
+    for( cmsghdr * cmsg = CMSG_FIRSTHDR( & msg ); cmsg; cmsg = CMSG_NXTHDR( & msg, cmsg ) )
+    {
+        if( cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS )
+        {
+            continue;
+        }
+        ::std::size_t fds_num = ( cmsg->cmsg_len - CMSG_LEN( 0 ) ) / sizeof( int );
+        const int * fd_ptr = reinterpret_cast< const int * >( CMSG_DATA( cmsg ) );
+        for( ::std::size_t idx = 0; idx < fds_num; idx++ )
+        {
+            fds.emplace_back( fd_ptr[ idx ] );
+        }
+    }
+    if( msg.msg_flags & MSG_CTRUNC )
+    {
+        ERROR_LOG( "Some of the passed descriptors are lost.\n" );
+    }
+    if( msg.msg_flags & MSG_TRUNC ) /* 'SOCK_SEQPACKET' : packet is bigger than buffer */
+    {
+        error = ::boost::asio::error::message_size;
+        return 0;
+    }
+    error = ErrCode();
+    return static_cast< ::std::size_t >( received );
+}
+
+/* EOF */
\ No newline at end of file
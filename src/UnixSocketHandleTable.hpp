@@ -0,0 +1,124 @@
+#ifndef UNIX_SOCKET_HANDLE_TABLE_HPP
+#define UNIX_SOCKET_HANDLE_TABLE_HPP
+
+#include "UnixSocket.h"
+
+namespace UnixSocket
+{
+
+template< typename Value >
+typename HandleTable< Value >::Slot * HandleTable< Value >::slotOf( ClientHandle handle ) const
+{
+    ::std::size_t index = handle & 0xFFFFFFFF;
+    if( index >= CHUNK_SIZE * MAX_CHUNKS )
+    {
+        return nullptr;
+    }
+    Chunk * chunk = m_chunks[ index / CHUNK_SIZE ].load( ::std::memory_order_acquire );
+    return chunk ? & ( * chunk )[ index % CHUNK_SIZE ] : nullptr;
+}
+
+template< typename Value >
+ClientHandle HandleTable< Value >::insert( const Value& value )
+{
+    ::std::uint32_t index;
+    {
+        ::std::lock_guard< ::std::mutex > lock( m_free_mtx );
+        if( ! m_free.empty() )
+        {
+            index = m_free.back();
+            m_free.pop_back();
+        }
+        else if( m_used < CHUNK_SIZE * MAX_CHUNKS )
+        {
+            index = m_used++;
+            if( index % CHUNK_SIZE == 0 ) /* First slot of the new chunk */
+            {
+                m_chunks[ index / CHUNK_SIZE ].store( new Chunk(), ::std::memory_order_release );
+            }
+        }
+        else
+        {
+            return INVALID_HANDLE;
+        }
+    }
+    Slot * slot = slotOf( index );
+    ::std::lock_guard< ::std::mutex > lock( slot->m_mtx );
+    slot->m_value = value;
+    return ( static_cast< ClientHandle >( slot->m_generation ) << 32 ) | index;
+}
+
+template< typename Value >
+Value HandleTable< Value >::find( ClientHandle handle ) const
+{
+    Slot * slot = slotOf( handle );
+    if( ! slot )
+    {
+        return Value{};
+    }
+    ::std::lock_guard< ::std::mutex > lock( slot->m_mtx );
+    return ( slot->m_generation == ( handle >> 32 ) ) ? slot->m_value : Value{};
+}
+
+template< typename Value >
+bool HandleTable< Value >::erase( ClientHandle handle )
+{
+    Slot * slot = slotOf( handle );
+    if( ! slot )
+    {
+        return false;
+    }
+    Value value; /* Destroyed out of the lock */
+    {
+        ::std::lock_guard< ::std::mutex > lock( slot->m_mtx );
+        if( slot->m_generation != ( handle >> 32 ) )
+        {
+            return false;
+        }
+        value = ::std::move( slot->m_value );
+        slot->m_value = Value{};
+        if( ++slot->m_generation == 0 ) /* Stale handles are rejected after it */
+        {
+            slot->m_generation = 1;
+        }
+    }
+    ::std::lock_guard< ::std::mutex > lock( m_free_mtx );
+    m_free.push_back( handle & 0xFFFFFFFF );
+    return true;
+}
+
+template< typename Value >
+void HandleTable< Value >::clear()
+{
+    ::std::lock_guard< ::std::mutex > lock( m_free_mtx );
+    for( ::std::uint32_t index = 0; index < m_used; index++ )
+    {
+        Slot * slot = slotOf( index );
+        Value value; /* Destroyed out of the slot's lock */
+        ::std::lock_guard< ::std::mutex > slot_lock( slot->m_mtx );
+        if( slot->m_value == Value{} )
+        {
+            continue; /* Already in 'm_free' */
+        }
+        value = ::std::move( slot->m_value );
+        slot->m_value = Value{};
+        if( ++slot->m_generation == 0 )
+        {
+            slot->m_generation = 1;
+        }
+        m_free.push_back( index );
+    }
+}
+
+template< typename Value >
+HandleTable< Value >::~HandleTable()
+{
+    for( auto& chunk : m_chunks )
+    {
+        delete chunk.load();
+    }
+}
+
+} //end namespace UnixSocket
+
+#endif /* UNIX_SOCKET_HANDLE_TABLE_HPP */
\ No newline at end of file
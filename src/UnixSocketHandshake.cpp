@@ -0,0 +1,83 @@
+#include "UnixSocket.h"
+
+using namespace UnixSocket;
+
+OutFrame UnixSocket::makeIdentification( Handshake handshake, Framing framing, 
+    const ::std::string& id_key, const ClientId& client_id, ::std::uint16_t caps )
+{
+    if( handshake == Handshake::BINARY )
+    {
+        HandshakeHeader body{ HANDSHAKE_VERSION, caps };
+        FrameHeader header = makeHeader( sizeof( body ) + client_id.size(),
+            FrameType::IDENTIFICATION );
+        Buffer payload;
+        if( framing != Framing::LENGTH_PREFIX )
+        { /* Queue writes no headers for other framings, server still expects it */
+            payload.append( reinterpret_cast< const char * >( & header ), sizeof( header ) );
+        }
+        payload.append( reinterpret_cast< const char * >( & body ), sizeof( body ) );
+        payload.append( client_id );
+        return OutFrame{ header, makeShared( ::std::move( payload ) ) };
+    }
+    Tree xml_tree;
+    xml_tree.put( id_key, client_id );
+    if( caps & CAP_GROUP ) /* <'id_key' group="1">ClientName</'id_key'> */
+    {
+        xml_tree.put( id_key + ".<xmlattr>.group", 1 );
+    }
+    ::std::ostringstream xml_stream;
+    PropTree::write_xml( xml_stream, xml_tree );
+    ConstBufferShPtr payload = makeShared( xml_stream.str() );
+    /* Service frame, so nothing queued after it goes ahead */
+    return OutFrame{ makeHeader( payload->size(), FrameType::IDENTIFICATION ), ::std::move( payload ) };
+}
+
+ClientId UnixSocket::parseIdentification( const Frame& frame, Handshake handshake, 
+    const ::std::string& id_key, ::std::uint16_t& caps )
+{
+    ClientId client_id;
+    caps = 0;
+    if( handshake == Handshake::BINARY )
+    {
+        HandshakeHeader body;
+        if( static_cast< FrameType >( frame.m_header.m_type ) != FrameType::IDENTIFICATION ||
+            frame.m_size < sizeof( body ) || 
+            frame.m_size > sizeof( body ) + MAX_ID_LENGTH )
+        {
+            ERROR_LOG( "Wrong handshake.\n" );
+            return ClientId{};
+        }
+        ::std::memcpy( & body, frame.m_data, sizeof( body ) );
+        if( body.m_version != HANDSHAKE_VERSION )
+        {
+            ERROR_LOG( "Unsupported handshake version %u.\n", body.m_version );
+            return ClientId{};
+        }
+        caps = body.m_caps;
+        client_id.assign( frame.m_data + sizeof( body ), frame.m_size - sizeof( body ) );
+    }
+    else
+    {
+        Tree xml_tree;
+        /* Avoids copy : */
+        boost::iostreams::stream< \
+            boost::iostreams::array_source > \
+                xml_stream( frame.m_data, frame.m_size );
+        try { /* Malformed XML throws too */
+            PropTree::read_xml( xml_stream, xml_tree );
+            client_id = xml_tree.get<std::string>( id_key );
+            caps = ( xml_tree.get( id_key + ".<xmlattr>.group", 0 ) != 0 ) ? CAP_GROUP : 0;
+        } catch( const ::std::exception& e )
+        {
+            ERROR_LOG( "%s\n", e.what() );
+            return ClientId{};
+        }
+    }
+    if( client_id.empty() )
+    {
+        ERROR_LOG( "Empty client name.\n" );
+    }
+    return client_id;
+}
+
+/* EOF */
\ No newline at end of file
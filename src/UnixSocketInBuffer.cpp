@@ -0,0 +1,235 @@
+#include "UnixSocket.h"
+
+#if defined( __AVX2__ ) || defined( __SSE2__ )
+#include <immintrin.h>
+#endif
+
+using namespace UnixSocket;
+
+/* Offset of 'tag' in the 'data', 'size' if there is none. Block of positions is checked 
+ * for the first and the last byte of the tag at once, only candidates are compared in full :
+ * XML bodies have a lot of '<', but few of them start the tag of the same length. */
+static ::std::size_t findTag( const char * data, ::std::size_t size, const ::std::string& tag )
+{
+    const ::std::size_t len = tag.size();
+    if( len == 0 || size < len )
+    {
+        return size;
+    }
+    const ::std::size_t last = size - len; //the last offset the tag may start at
+    ::std::size_t pos = 0;
+#if defined( __AVX2__ )
+    const __m256i first_byte = _mm256_set1_epi8( tag.front() );
+    const __m256i last_byte = _mm256_set1_epi8( tag.back() );
+    for( ; pos + 32 <= last + 1; pos += 32 )
+    {
+        __m256i heads = _mm256_loadu_si256( reinterpret_cast< const __m256i * >( data + pos ) );
+        __m256i tails = _mm256_loadu_si256( 
+            reinterpret_cast< const __m256i * >( data + pos + len - 1 ) );
+        ::std::uint32_t mask = static_cast< ::std::uint32_t >( _mm256_movemask_epi8( 
+            _mm256_and_si256( _mm256_cmpeq_epi8( heads, first_byte ), 
+                _mm256_cmpeq_epi8( tails, last_byte ) ) ) );
+        for( ; mask != 0; mask &= mask - 1 )
+        {
+            ::std::size_t candidate = pos + __builtin_ctz( mask );
+            if( ::std::memcmp( data + candidate, tag.data(), len ) == 0 )
+            {
+                return candidate;
+            }
+        }
+    }
+#elif defined( __SSE2__ )
+    const __m128i first_byte = _mm_set1_epi8( tag.front() );
+    const __m128i last_byte = _mm_set1_epi8( tag.back() );
+    for( ; pos + 16 <= last + 1; pos += 16 )
+    {
+        __m128i heads = _mm_loadu_si128( reinterpret_cast< const __m128i * >( data + pos ) );
+        __m128i tails = _mm_loadu_si128( 
+            reinterpret_cast< const __m128i * >( data + pos + len - 1 ) );
+        ::std::uint32_t mask = static_cast< ::std::uint32_t >( _mm_movemask_epi8( 
+            _mm_and_si128( _mm_cmpeq_epi8( heads, first_byte ), 
+                _mm_cmpeq_epi8( tails, last_byte ) ) ) );
+        for( ; mask != 0; mask &= mask - 1 )
+        {
+            ::std::size_t candidate = pos + __builtin_ctz( mask );
+            if( ::std::memcmp( data + candidate, tag.data(), len ) == 0 )
+            {
+                return candidate;
+            }
+        }
+    }
+#endif
+    /* Rest shorter than the block, or no SIMD at all */
+    while( pos <= last )
+    {
+        const void * found = ::std::memchr( data + pos, tag.front(), last - pos + 1 );
+        if( found == nullptr )
+        {
+            return size;
+        }
+        pos = static_cast< const char * >( found ) - data;
+        if( ::std::memcmp( data + pos, tag.data(), len ) == 0 )
+        {
+            return pos;
+        }
+        pos++;
+    }
+    return size;
+}
+
+::boost::asio::mutable_buffer InBuffer::prepare( ::std::size_t min_space )
+{
+    min_space = ::std::max( min_space, m_missing );
+    bool is_retained = ( m_slab.use_count() > 1 );
+    if( m_begin == m_end && ! is_retained ) /* Everything is consumed */
+    {
+        m_begin = m_end = m_scan = 0;
+    }
+    if( m_slab->size() - m_end < min_space )
+    {
+        ::std::size_t tail = m_end - m_begin; //the last incomplete frame
+        ::std::size_t capacity = m_slab->size();
+        if( capacity - tail < min_space )
+        {
+            capacity = ::std::max( capacity * 2, tail + min_space );
+        }
+        if( is_retained ) /* Slab belongs to retained frames now */
+        {
+            BufferShPtr slab = ::std::make_shared< Buffer >( capacity, '\0' );
+            ::std::memcpy( & ( * slab )[ 0 ], m_slab->data() + m_begin, tail );
+            m_slab = ::std::move( slab );
+        }
+        else
+        {
+            ::std::memmove( & ( * m_slab )[ 0 ], m_slab->data() + m_begin, tail );
+            m_slab->resize( capacity );
+        }
+        m_scan = ( m_scan > m_begin ) ? m_scan - m_begin : 0;
+        m_begin = 0;
+        m_end = tail;
+    }
+    return ::boost::asio::buffer( & ( * m_slab )[ m_end ], m_slab->size() - m_end );
+}
+
+void InBuffer::commit( ::std::size_t bytes_transferred )
+{
+    m_end += bytes_transferred;
+}
+
+bool InBuffer::next( Framing framing, const ::std::string& end_tag, Frame& frame )
+{
+    while( cut( framing, end_tag, frame ) )
+    {
+        if( ! ( frame.m_header.m_flags & FLAG_CHUNK ) || assemble( frame ) )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Pieces are copied once, frames of higher priority and pieces of other lanes 
+ * may come between them */
+bool InBuffer::assemble( Frame& frame )
+{
+    if( m_assembled != PRIORITY_LANES )
+    { /* Previous message is reused or, if retained by the user, left to the user */
+        BufferShPtr& given = m_assembly[ m_assembled ];
+        if( given.use_count() > 1 )
+        {
+            given.reset();
+        }
+        else
+        {
+            given->clear(); /* Capacity stays for the next message */
+        }
+        m_assembled = PRIORITY_LANES;
+    }
+    ::std::size_t lane = chunkLane( frame.m_header );
+    if( lane >= PRIORITY_LANES )
+    {
+        ERROR_LOG( "Piece of the unknown lane %lu is dropped.\n", lane );
+        return false;
+    }
+    BufferShPtr& assembly = m_assembly[ lane ];
+    if( ! assembly )
+    {
+        assembly = ::std::make_shared< Buffer >();
+    }
+    assembly->append( frame.m_data, frame.m_size );
+    if( frame.m_header.m_flags & FLAG_MORE )
+    {
+        return false;
+    }
+    m_assembled = lane;
+    frame.m_header = makeHeader( assembly->size() );
+    frame.m_data = assembly->data();
+    frame.m_size = assembly->size();
+    frame.m_slab = & assembly;
+    return true;
+}
+
+bool InBuffer::cut( Framing framing, const ::std::string& end_tag, Frame& frame )
+{
+    const char * begin = m_slab->data() + m_begin;
+    frame.m_slab = & m_slab;
+    ::std::size_t available = m_end - m_begin;
+    switch( framing )
+    {
+        case Framing::DELIMITER :
+        { /* Bytes checked by the previous reads aren't scanned again */
+            ::std::size_t from = ::std::max( m_scan, m_begin );
+            ::std::size_t pos = findTag( m_slab->data() + from, m_end - from, end_tag );
+            if( pos == m_end - from )
+            { /* Tag may be cut by the end of data, its head is checked again */
+                ::std::size_t head = ::std::min( m_end, end_tag.size() - 1 );
+                m_scan = ::std::max( from, m_end - head );
+                return false;
+            }
+            frame.m_size = from + pos - m_begin + end_tag.size();
+            frame.m_data = begin;
+            frame.m_header = makeHeader( frame.m_size );
+            m_begin += frame.m_size;
+            m_scan = m_begin;
+            return true;
+        }
+        case Framing::LENGTH_PREFIX :
+        {
+            if( available < sizeof( FrameHeader ) )
+            {
+                m_missing = 0;
+                return false;
+            }
+            ::std::memcpy( & frame.m_header, begin, sizeof( FrameHeader ) );
+            ::std::size_t frame_size = sizeof( FrameHeader ) + frame.m_header.m_length;
+            if( available < frame_size )
+            {
+                m_missing = frame_size - available; /* Next read should bring whole body */
+                return false;
+            }
+            m_missing = 0;
+            frame.m_data = begin + sizeof( FrameHeader );
+            frame.m_size = frame.m_header.m_length;
+            m_begin += frame_size;
+            return true;
+        }
+        case Framing::PACKET : /* Each read brings exactly one packet */
+        {
+            if( available == 0 )
+            {
+                return false;
+            }
+            frame.m_size = available;
+            frame.m_data = begin;
+            frame.m_header = makeHeader( frame.m_size );
+            m_begin += frame.m_size;
+            return true;
+        }
+        default :
+        {
+            throw std::runtime_error( "Undefined framing type.\n" );
+        }
+    } //end switch
+}
+
+/* EOF */
\ No newline at end of file
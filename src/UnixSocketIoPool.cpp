@@ -0,0 +1,96 @@
+#include "UnixSocket.h"
+
+using namespace UnixSocket;
+
+void IoPool::start( ::std::size_t threads, Balance balance )
+{
+    if( threads == 0 )
+    {
+        threads = ::std::max( 1u, ::std::thread::hardware_concurrency() );
+    }
+    m_balance = balance;
+    m_load = ::std::make_unique< ::std::atomic< ::std::size_t >[] >( threads );
+    for( ::std::size_t idx = 0; idx < threads; idx++ )
+    {
+        m_load[ idx ].store( 0 );
+        m_services.emplace_back( ::std::make_unique< IoService >( 1 ) ); //one thread per 'io_service'
+        m_guards.emplace_back( ::boost::asio::make_work_guard( * m_services.back() ) );
+    }
+    for( auto& io_service : m_services )
+    {
+        IoService * io_service_ptr = io_service.get();
+        auto work = [ io_service_ptr ](){ io_service_ptr->run(); };
+#ifdef THREAD_IMPLEMENTATION
+        m_workers.emplace_back( work );
+#else
+        m_futures.emplace_back( ::std::async( ::std::launch::async, work ) );
+#endif
+    }
+    INFO_LOG( GRN, "%lu I/O threads started.\n", threads );
+}
+
+IoPool::Index IoPool::acquire()
+{
+    Index idx = 0;
+    switch( m_balance )
+    {
+        case Balance::ROUND_ROBIN :
+        {
+            idx = m_next.fetch_add( 1 ) % m_services.size();
+            break;
+        }
+        case Balance::LEAST_LOADED :
+        {
+            for( Index cur = 1; cur < m_services.size(); cur++ )
+            {
+                if( m_load[ cur ].load() < m_load[ idx ].load() )
+                {
+                    idx = cur;
+                }
+            }
+            break;
+        }
+        default :
+        {
+            throw std::runtime_error( "Undefined balance type.\n" );
+        }
+    } //end switch
+    m_load[ idx ].fetch_add( 1 );
+    return idx;
+}
+
+void IoPool::release( Index idx )
+{
+    m_load[ idx ].fetch_sub( 1 );
+}
+
+void IoPool::stop()
+{
+    m_guards.clear();
+    for( auto& io_service : m_services )
+    {
+        io_service->stop();
+    }
+#ifdef THREAD_IMPLEMENTATION
+    for( auto& worker : m_workers )
+    {
+        worker.join();
+    }
+    m_workers.clear();
+#else
+    for( auto& future : m_futures )
+    {
+        future.get();
+    }
+    m_futures.clear();
+#endif
+}
+
+IoPool::~IoPool()
+{
+    stop();
+    /* Pending handlers are destroyed here, while the rest of the pool is alive */
+    m_services.clear();
+}
+
+/* EOF */
\ No newline at end of file
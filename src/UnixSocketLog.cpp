@@ -0,0 +1,139 @@
+#include "UnixSocket.h"
+
+#include <cstdarg>
+#include <cstdio>
+
+using namespace UnixSocket;
+
+#define COLOR_RESET     "\033[0m"
+#define IDLE_DELAY      ::std::chrono::milliseconds( 1 ) /* Drain thread sleeps if there is nothing */
+
+/* Color, place of the error, the message itself. Cut text still ends the line and the color. */
+static void formatText( char * text, ::std::size_t size, int level, const char * color,
+    const char * func, int line, const char * format, va_list args )
+{
+    const ::std::size_t tail = sizeof( COLOR_RESET ); //with '\n' instead of '\0'
+    int len = ( level == UNIX_SOCKET_LOG_ERROR ) ?
+        ::std::snprintf( text, size - tail, "%s%s:%d ", color, func, line ) :
+        ::std::snprintf( text, size - tail, "%s", color );
+    ::std::size_t used = ::std::min< ::std::size_t >( ::std::max( len, 0 ), size - tail - 1 );
+    len = ::std::vsnprintf( text + used, size - tail - used, format, args );
+    used = ::std::min< ::std::size_t >( used + ::std::max( len, 0 ), size - tail - 1 );
+    if( used + 1 == size - tail && text[ used - 1 ] != '\n' )
+    {
+        text[ used++ ] = '\n';
+    }
+    ::std::memcpy( text + used, COLOR_RESET, sizeof( COLOR_RESET ) );
+}
+
+static void writeText( int level, const char * text )
+{
+    ::std::fputs( text, ( level == UNIX_SOCKET_LOG_ERROR ) ? stderr : stdout );
+}
+
+Logger& Logger::instance()
+{
+    /* Leaked : destructors of static objects may still log */
+    static Logger * logger = new Logger();
+    return * logger;
+}
+
+Logger::Logger()
+    : m_records( new Record[ CAPACITY ] )
+{
+    for( ::std::size_t idx = 0; idx < CAPACITY; idx++ )
+    {
+        m_records[ idx ].m_seq.store( idx, ::std::memory_order_relaxed );
+    }
+    ::std::thread( &Logger::drain, this ).detach();
+    ::std::atexit( []()
+        {
+            Logger& logger = Logger::instance();
+            logger.m_is_sync.store( true );
+            logger.flush();
+        } );
+}
+
+/* Bounded multi producer queue : the record is claimed by the move of 'm_head',
+ * its sequence number tells the consumer, that it's filled. */
+void Logger::log( int level, const char * color, const char * func, int line,
+    const char * format, ... )
+{
+    va_list args;
+    va_start( args, format );
+    if( m_is_sync.load( ::std::memory_order_relaxed ) )
+    {
+        char text[ RECORD_SIZE ];
+        ::formatText( text, sizeof( text ), level, color, func, line, format, args );
+        va_end( args );
+        writeText( level, text );
+        return;
+    }
+    ::std::uint64_t pos = m_head.load( ::std::memory_order_relaxed );
+    Record * record = nullptr;
+    while( true )
+    {
+        record = & m_records[ pos & ( CAPACITY - 1 ) ];
+        ::std::int64_t diff = static_cast< ::std::int64_t >( 
+            record->m_seq.load( ::std::memory_order_acquire ) - pos );
+        if( diff == 0 )
+        {
+            if( m_head.compare_exchange_weak( pos, pos + 1, ::std::memory_order_relaxed ) )
+            {
+                break;
+            }
+        }
+        else if( diff < 0 )
+        { /* Terminal is slower than the producers, caller doesn't wait for it */
+            m_dropped.fetch_add( 1, ::std::memory_order_relaxed );
+            va_end( args );
+            return;
+        }
+        else
+        {
+            pos = m_head.load( ::std::memory_order_relaxed );
+        }
+    }
+    record->m_level = level;
+    ::formatText( record->m_text, RECORD_SIZE, level, color, func, line, format, args );
+    va_end( args );
+    record->m_seq.store( pos + 1, ::std::memory_order_release );
+}
+
+bool Logger::pop()
+{
+    ::std::uint64_t pos = m_tail.load( ::std::memory_order_relaxed );
+    Record& record = m_records[ pos & ( CAPACITY - 1 ) ];
+    if( record.m_seq.load( ::std::memory_order_acquire ) != pos + 1 )
+    {
+        return false;
+    }
+    writeText( record.m_level, record.m_text );
+    record.m_seq.store( pos + CAPACITY, ::std::memory_order_release );
+    m_tail.store( pos + 1, ::std::memory_order_release );
+    return true;
+}
+
+void Logger::drain()
+{
+    while( true )
+    {
+        if( ! pop() )
+        { /* Records of one burst go out with one write */
+            ::std::fflush( stdout );
+            ::std::this_thread::sleep_for( IDLE_DELAY );
+        }
+    }
+}
+
+void Logger::flush()
+{
+    ::std::uint64_t head = m_head.load();
+    while( m_tail.load( ::std::memory_order_acquire ) < head )
+    {
+        ::std::this_thread::sleep_for( IDLE_DELAY );
+    }
+    ::std::fflush( stdout );
+}
+
+/* EOF */
\ No newline at end of file
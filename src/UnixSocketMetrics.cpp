@@ -0,0 +1,81 @@
+#include "UnixSocket.h"
+
+#include <algorithm>
+
+using namespace UnixSocket;
+
+/*-----------------*/
+/*--- Histogram ---*/
+/*-----------------*/
+void Histogram::add( StatsClock::duration duration )
+{
+    ::std::uint64_t us = static_cast< ::std::uint64_t >( ::std::max< ::std::int64_t >( 0,
+        ::std::chrono::duration_cast< ::std::chrono::microseconds >( duration ).count() ) );
+    /* Bucket is the number of significant bits */
+    ::std::size_t idx = ::std::min< ::std::size_t >( BUCKETS - 1, 
+        ( us == 0 ) ? 0 : 64 - __builtin_clzll( us ) );
+    m_buckets[ idx ].fetch_add( 1, ::std::memory_order_relaxed );
+    m_count.fetch_add( 1, ::std::memory_order_relaxed );
+    m_sum_us.fetch_add( us, ::std::memory_order_relaxed );
+    ::std::uint64_t max_us = m_max_us.load( ::std::memory_order_relaxed );
+    while( us > max_us && 
+        ! m_max_us.compare_exchange_weak( max_us, us, ::std::memory_order_relaxed ) )
+    { }
+}
+
+/* Buckets are read one by one, counts may be off by the adds made meanwhile */
+Histogram::Snapshot Histogram::snapshot() const
+{
+    Snapshot snapshot;
+    for( ::std::size_t idx = 0; idx < BUCKETS; idx++ )
+    {
+        snapshot.m_buckets[ idx ] = m_buckets[ idx ].load( ::std::memory_order_relaxed );
+    }
+    snapshot.m_count = m_count.load( ::std::memory_order_relaxed );
+    snapshot.m_sum_us = m_sum_us.load( ::std::memory_order_relaxed );
+    snapshot.m_max_us = m_max_us.load( ::std::memory_order_relaxed );
+    return snapshot;
+}
+
+::std::uint64_t Histogram::Snapshot::percentile( double share ) const
+{
+    ::std::uint64_t total = 0;
+    for( ::std::uint64_t count : m_buckets )
+    {
+        total += count;
+    }
+    if( total == 0 )
+    {
+        return 0;
+    }
+    ::std::uint64_t rank = static_cast< ::std::uint64_t >( share * total );
+    ::std::uint64_t seen = 0;
+    for( ::std::size_t idx = 0; idx < BUCKETS; idx++ )
+    {
+        seen += m_buckets[ idx ];
+        if( seen > rank )
+        {
+            return ::std::min< ::std::uint64_t >( m_max_us, ( 1ull << idx ) - 1 );
+        }
+    }
+    return m_max_us;
+}
+
+/*---------------*/
+/*--- Metrics ---*/
+/*---------------*/
+void Metrics::fill( ConnectionStats& stats ) const
+{
+    stats.m_bytes_in = m_bytes_in.load( ::std::memory_order_relaxed );
+    stats.m_frames_in = m_frames_in.load( ::std::memory_order_relaxed );
+    stats.m_bytes_out = m_bytes_out.load( ::std::memory_order_relaxed );
+    stats.m_frames_out = m_frames_out.load( ::std::memory_order_relaxed );
+    stats.m_read_errors = m_read_errors.load( ::std::memory_order_relaxed );
+    stats.m_write_errors = m_write_errors.load( ::std::memory_order_relaxed );
+    stats.m_overflows = m_overflows.load( ::std::memory_order_relaxed );
+    stats.m_identification = ::std::chrono::microseconds( 
+        m_identification_us.load( ::std::memory_order_relaxed ) );
+    stats.m_send_latency = m_send_latency.snapshot();
+}
+
+/* EOF */
\ No newline at end of file
@@ -0,0 +1,567 @@
+#include "UnixSocket.h"
+
+#include <sys/socket.h>
+#include <algorithm>
+
+using namespace UnixSocket;
+
+#define MAX_PACKETS 64 /* Packets per 'sendmmsg' */
+
+OutFrame UnixSocket::makeFrame( Chunks&& chunks )
+{
+    if( chunks.empty() )
+    {
+        return OutFrame{ makeHeader( 0 ), makeShared( Buffer{} ) };
+    }
+    OutFrame frame{ FrameHeader{}, ::std::move( chunks.front() ) };
+    frame.m_chunks.assign( ::std::make_move_iterator( chunks.begin() + 1 ), 
+        ::std::make_move_iterator( chunks.end() ) );
+    frame.m_header = makeHeader( frame.size() );
+    return frame;
+}
+
+void OutQueue::start( Socket& socket, Transport transport, Framing framing, 
+    SentHandler sent_handler, ErrorHandler error_handler, ::std::weak_ptr< void > owner )
+{
+    ::std::lock_guard< ::std::mutex > lock( m_mtx );
+    m_socket_ptr = & socket;
+    m_transport = transport;
+    m_framing = framing;
+    m_sent_handler = ::std::move( sent_handler );
+    m_error_handler = ::std::move( error_handler );
+    m_owner = ::std::move( owner );
+    m_is_broken = false;
+}
+
+void OutQueue::limit( const Watermarks& watermarks, WatermarkHandler watermark_handler )
+{
+    ::std::lock_guard< ::std::mutex > lock( m_mtx );
+    m_watermarks = watermarks;
+    m_watermark_handler = ::std::move( watermark_handler );
+}
+
+void OutQueue::split( ::std::size_t chunk_size )
+{
+    ::std::lock_guard< ::std::mutex > lock( m_mtx );
+    m_chunk_size = chunk_size;
+}
+
+void OutQueue::measure( Metrics& metrics )
+{
+    ::std::lock_guard< ::std::mutex > lock( m_mtx );
+    m_metrics_ptr = & metrics;
+}
+
+void OutQueue::depth( ::std::size_t& bytes, ::std::size_t& frames )
+{
+    ::std::lock_guard< ::std::mutex > lock( m_mtx );
+    bytes = m_queued_bytes;
+    frames = m_queued_frames;
+}
+
+Result OutQueue::push( OutFrame&& frame )
+{
+    ::std::size_t size = frameSize( frame );
+    Result result = Result::ALL_GOOD;
+    bool is_high = false; //high watermark is reached by this frame
+    bool is_started = false;
+    {
+        ::std::unique_lock< ::std::mutex > lock( m_mtx );
+        if( m_is_broken )
+        {
+            return Result::SEND_ERROR;
+        }
+        if( frame.m_header.m_type == static_cast< ::std::uint16_t >( FrameType::DATA ) &&
+            isFull( size ) )
+        {
+            is_high = ! m_is_high;
+            m_is_high = true;
+            result = overflow( lock, size, is_high );
+        }
+        if( result != Result::ALL_GOOD && m_metrics_ptr )
+        {
+            Metrics::add( m_metrics_ptr->m_overflows );
+        }
+        if( result == Result::ALL_GOOD )
+        {
+            frame.m_queued_at = m_metrics_ptr ? StatsClock::now() : StatsClock::time_point{};
+            m_queued_bytes += size;
+            m_queued_frames++;
+            frame.m_seq = ++m_pushed;
+            Lane& lane = ( frame.m_header.m_type == static_cast< ::std::uint16_t >( FrameType::DATA ) ) ?
+                m_lanes[ static_cast< ::std::size_t >( frame.m_priority ) ] : m_service;
+            lane.emplace_back( ::std::move( frame ) );
+            /* Otherwise will be sent with the next gathered write */
+            is_started = ! m_is_writing;
+            m_is_writing = true;
+        }
+    }
+    if( is_high && m_watermark_handler )
+    {
+        m_watermark_handler( true );
+    }
+    if( is_started )
+    { /* Socket isn't thread safe, all writes go through its own 'io_service' */
+        ::boost::asio::post( m_socket_ptr->get_executor(), 
+            [ this, keep = m_owner.lock() ](){ write(); } );
+    }
+    return result;
+}
+
+/* 'ALL_GOOD' - frame may be queued */
+Result OutQueue::overflow( ::std::unique_lock< ::std::mutex >& lock, 
+    ::std::size_t size, bool& is_high )
+{
+    switch( m_watermarks.m_overflow )
+    {
+        case Overflow::DROP_OLDEST :
+        {
+            dropOldest( size );
+            return Result::ALL_GOOD;
+        }
+        case Overflow::DROP_NEWEST :
+        {
+            return Result::WOULD_BLOCK;
+        }
+        case Overflow::DISCONNECT :
+        {
+            m_is_broken = true;
+            ::boost::asio::post( m_socket_ptr->get_executor(), 
+                [ this, keep = m_owner.lock() ](){ disconnect(); } );
+            return Result::SEND_ERROR;
+        }
+        case Overflow::BLOCK :
+        {
+            /* Queue is drained by this thread, waiting here would never end */
+            IoService& io_service = static_cast< IoService& >( 
+                m_socket_ptr->get_executor().context() );
+            if( io_service.get_executor().running_in_this_thread() )
+            {
+                return Result::WOULD_BLOCK;
+            }
+            /* Other blocked callers may take the room first, so wait goes on until there is
+             * room for this frame. Empty queue takes any one. */
+            StatsClock::time_point deadline = StatsClock::now() + m_watermarks.m_block_timeout;
+            while( ! m_is_broken && m_queued_frames != 0 && isFull( size ) )
+            {
+                if( ! m_is_high )
+                { /* Queue is full again, its relief wakes up the ones still waiting */
+                    m_is_high = true;
+                    is_high = true;
+                }
+                if( is_high && m_watermark_handler )
+                { /* User should know before the wait */
+                    is_high = false;
+                    lock.unlock();
+                    m_watermark_handler( true );
+                    lock.lock();
+                    continue; /* Queue could be relieved meanwhile */
+                }
+                is_high = false;
+                if( m_relieved_cv.wait_until( lock, deadline ) == ::std::cv_status::timeout )
+                {
+                    return Result::WOULD_BLOCK;
+                }
+            }
+            return m_is_broken ? Result::SEND_ERROR : Result::ALL_GOOD;
+        }
+        default :
+        {
+            throw std::runtime_error( "Undefined overflow policy.\n" );
+        }
+    } //end switch
+}
+
+void OutQueue::write()
+{
+    if( m_written == m_writing.size() )
+    {
+        m_writing.clear(); /* Payloads are released here */
+        m_written = 0;
+        ::std::lock_guard< ::std::mutex > lock( m_mtx );
+        take();
+        if( m_writing.empty() )
+        {
+            m_is_writing = false;
+            return;
+        }
+    }
+    if( ! m_writing[ m_written ].m_fds.empty() )
+    {
+        writeFds();
+        return;
+    }
+    if( m_transport == Transport::SEQPACKET )
+    {
+        writePackets();
+        return;
+    }
+    /* Gather everything up to the next frame with descriptors */
+    m_buffers.clear();
+    ::std::size_t frames = 0;
+    for( auto it = m_writing.begin() + m_written; 
+        it != m_writing.end() && it->m_fds.empty(); ++it, ++frames )
+    {
+        gather( * it, m_framing == Framing::LENGTH_PREFIX );
+    }
+    ::boost::asio::async_write( * m_socket_ptr, m_buffers,
+        [ &, frames, keep = m_owner.lock() ]( const ErrCode& error, ::std::size_t bytes_transferred )
+        {
+            if( error )
+            {
+                fail( error );
+                return;
+            }
+            sent( frames );
+            this->write();
+        } );
+}
+
+void OutQueue::writeFds()
+{
+    m_socket_ptr->async_wait( Socket::wait_write,
+        [ &, keep = m_owner.lock() ]( const ErrCode& error )
+        {
+            if( error )
+            {
+                fail( error );
+                return;
+            }
+            OutFrame& frame = m_writing[ m_written ];
+            m_buffers.clear();
+            gather( frame, true );
+            ErrCode send_error;
+            ::std::size_t bytes_sent = sendWithFds( * m_socket_ptr, 
+                m_buffers.data(), m_buffers.size(), frame.m_fds, send_error );
+            if( send_error == ::boost::asio::error::would_block ||
+                send_error == ::boost::asio::error::try_again )
+            {
+                this->writeFds();
+                return;
+            }
+            if( send_error )
+            {
+                fail( send_error );
+                return;
+            }
+            frame.m_fds.clear(); /* Peer has its own copies now */
+            if( bytes_sent == sizeof( FrameHeader ) + frame.size() )
+            {
+                sent( 1 );
+                this->write();
+                return;
+            }
+            writeTail( bytes_sent );
+        } );
+}
+
+/* Gathered write would glue frames into one packet, 
+ * so each frame gets its own message of one 'sendmmsg' */
+void OutQueue::writePackets()
+{
+    m_socket_ptr->async_wait( Socket::wait_write,
+        [ &, keep = m_owner.lock() ]( const ErrCode& error )
+        {
+            if( error )
+            {
+                fail( error );
+                return;
+            }
+            ::std::array< mmsghdr, MAX_PACKETS > messages;
+            ::std::array< ::std::size_t, MAX_PACKETS > iov_begin;
+            unsigned int count = 0;
+            m_iov.clear();
+            for( auto it = m_writing.begin() + m_written; it != m_writing.end() && 
+                it->m_fds.empty() && count < MAX_PACKETS; ++it, ++count )
+            {
+                iov_begin[ count ] = m_iov.size();
+                if( m_framing == Framing::LENGTH_PREFIX )
+                {
+                    m_iov.push_back( iovec{ & it->m_header, sizeof( FrameHeader ) } );
+                }
+                m_iov.push_back( iovec{ 
+                    const_cast< char * >( it->m_payload->data() ), it->m_payload->size() } );
+                for( const ConstBufferShPtr& chunk : it->m_chunks )
+                {
+                    m_iov.push_back( iovec{ const_cast< char * >( chunk->data() ), chunk->size() } );
+                }
+            }
+            /* Vector doesn't grow any more, pointers into it are stable */
+            for( unsigned int idx = 0; idx < count; idx++ )
+            {
+                ::std::size_t iov_end = ( idx + 1 < count ) ? iov_begin[ idx + 1 ] : m_iov.size();
+                messages[ idx ] = mmsghdr{};
+                messages[ idx ].msg_hdr.msg_iov = & m_iov[ iov_begin[ idx ] ];
+                messages[ idx ].msg_hdr.msg_iovlen = iov_end - iov_begin[ idx ];
+            }
+            int sent_num = ::sendmmsg( m_socket_ptr->native_handle(), messages.data(), count,
+                MSG_DONTWAIT | MSG_NOSIGNAL );
+            if( sent_num < 0 )
+            {
+                if( errno == EAGAIN || errno == EWOULDBLOCK )
+                {
+                    this->writePackets();
+                    return;
+                }
+                fail( ErrCode( errno, ::boost::system::system_category() ) );
+                return;
+            }
+            sent( static_cast< ::std::size_t >( sent_num ) );
+            this->write();
+        } );
+}
+
+void OutQueue::writeTail( ::std::size_t bytes_sent )
+{
+    m_buffers.clear();
+    gather( m_writing[ m_written ], true );
+    /* Pieces taken by 'sendmsg' are cut off */
+    auto it = m_buffers.begin();
+    while( bytes_sent >= it->size() )
+    {
+        bytes_sent -= it->size();
+        ++it;
+    }
+    * it += bytes_sent;
+    m_buffers.erase( m_buffers.begin(), it );
+    ::boost::asio::async_write( * m_socket_ptr, m_buffers,
+        [ &, keep = m_owner.lock() ]( const ErrCode& error, ::std::size_t bytes_transferred )
+        {
+            if( error )
+            {
+                fail( error );
+                return;
+            }
+            sent( 1 );
+            this->write();
+        } );
+}
+
+void OutQueue::take()
+{
+    ::std::size_t budget = ( m_chunk_size != 0 ) ? m_chunk_size : SIZE_MAX;
+    Lane * lane = nullptr;
+    while( budget != 0 && ( lane = next() ) != nullptr )
+    {
+        OutFrame& frame = lane->front();
+        ::std::size_t left = frame.size() - frame.m_offset;
+        if( left > budget && isSplittable( frame ) )
+        {
+            if( budget < m_chunk_size / 4 && ! m_writing.empty() )
+            {
+                return; /* Too small piece, whole one goes with the next batch */
+            }
+            OutFrame piece{ makeHeader( budget ), frame.m_payload };
+            piece.m_header.m_flags = FLAG_CHUNK | FLAG_MORE | 
+                ( static_cast< ::std::uint16_t >( frame.m_priority ) << 8 );
+            piece.m_chunks = frame.m_chunks;
+            piece.m_offset = frame.m_offset;
+            m_writing.emplace_back( ::std::move( piece ) );
+            frame.m_offset += budget;
+            return;
+        }
+        if( frame.m_offset != 0 )
+        { /* Last piece completes the frame */
+            frame.m_header = makeHeader( left );
+            frame.m_header.m_flags = FLAG_CHUNK | 
+                ( static_cast< ::std::uint16_t >( frame.m_priority ) << 8 );
+        }
+        m_writing.emplace_back( ::std::move( frame ) );
+        lane->pop_front();
+        budget -= ::std::min( budget, left );
+    }
+}
+
+/* Identification and shared memory markers must keep their place in the stream */
+OutQueue::Lane * OutQueue::next()
+{
+    ::std::uint64_t barrier = m_service.empty() ? UINT64_MAX : m_service.front().m_seq;
+    for( Lane& lane : m_lanes )
+    {
+        if( ! lane.empty() && lane.front().m_seq < barrier )
+        {
+            return & lane;
+        }
+    }
+    return m_service.empty() ? nullptr : & m_service;
+}
+
+/* Each lane may have its first frame written in pieces, peer reassembles them by the lane */
+bool OutQueue::isSplittable( const OutFrame& frame ) const
+{
+    if( frame.m_offset != 0 )
+    {
+        return true;
+    }
+    return m_chunk_size != 0 && 
+        m_framing == Framing::LENGTH_PREFIX && m_transport == Transport::STREAM &&
+        frame.m_fds.empty() && 
+        frame.m_header.m_type == static_cast< ::std::uint16_t >( FrameType::DATA );
+}
+
+/* Piece of the split frame takes only its part of the body */
+void OutQueue::gather( const OutFrame& frame, bool with_header )
+{
+    if( with_header )
+    {
+        m_buffers.emplace_back( & frame.m_header, sizeof( FrameHeader ) );
+    }
+    ::std::size_t skip = frame.m_offset;
+    ::std::size_t length = ( frame.m_header.m_flags & FLAG_CHUNK ) ? 
+        frame.m_header.m_length : frame.size();
+    auto add = [ & ]( const ConstBufferShPtr& chunk )
+    {
+        if( skip >= chunk->size() )
+        {
+            skip -= chunk->size();
+            return;
+        }
+        ::std::size_t size = ::std::min( chunk->size() - skip, length );
+        if( size != 0 )
+        {
+            m_buffers.emplace_back( chunk->data() + skip, size );
+        }
+        skip = 0;
+        length -= size;
+    };
+    add( frame.m_payload );
+    for( const ConstBufferShPtr& chunk : frame.m_chunks )
+    {
+        add( chunk );
+    }
+}
+
+void OutQueue::sent( ::std::size_t frames )
+{
+    ::std::size_t bytes = 0;
+    StatsClock::time_point now = m_metrics_ptr ? StatsClock::now() : StatsClock::time_point{};
+    ::std::size_t pieces = 0;
+    for( ::std::size_t idx = 0; idx < frames; idx++ )
+    {
+        const OutFrame& frame = m_writing[ m_written++ ];
+        if( frame.m_header.m_flags & FLAG_MORE )
+        { /* Frame is counted once, with its last piece */
+            pieces++;
+            continue;
+        }
+        if( m_metrics_ptr )
+        {
+            m_metrics_ptr->m_send_latency.add( now - frame.m_queued_at );
+        }
+        m_sent_handler( frameSize( frame ) );
+        bytes += frameSize( frame );
+    }
+    bool is_relieved = false;
+    {
+        ::std::lock_guard< ::std::mutex > lock( m_mtx );
+        m_queued_bytes -= bytes;
+        m_queued_frames -= frames - pieces;
+        if( m_is_high && isRelieved() )
+        {
+            m_is_high = false;
+            is_relieved = true;
+        }
+    }
+    if( is_relieved )
+    {
+        m_relieved_cv.notify_all();
+        if( m_watermark_handler )
+        {
+            m_watermark_handler( false );
+        }
+    }
+}
+
+void OutQueue::fail( const ErrCode& error )
+{
+    {
+        ::std::lock_guard< ::std::mutex > lock( m_mtx );
+        m_is_broken = true;
+        m_is_writing = false;
+        for( Lane& lane : m_lanes )
+        {
+            lane.clear();
+        }
+        m_service.clear();
+        m_queued_bytes = 0;
+        m_queued_frames = 0;
+    }
+    m_relieved_cv.notify_all(); /* Blocked callers get 'Result::SEND_ERROR' */
+    m_writing.clear();
+    m_written = 0;
+    m_error_handler( error );
+}
+
+/* Write in flight isn't touched, it's aborted when the owner closes the socket */
+void OutQueue::disconnect()
+{
+    {
+        ::std::lock_guard< ::std::mutex > lock( m_mtx );
+        auto drop = [ this ]( Lane& lane )
+        {
+            for( const OutFrame& frame : lane )
+            {
+                m_queued_bytes -= frameSize( frame );
+            }
+            m_queued_frames -= lane.size();
+            lane.clear();
+        };
+        ::std::for_each( m_lanes.begin(), m_lanes.end(), drop );
+        drop( m_service );
+    }
+    m_relieved_cv.notify_all(); /* Blocked callers get 'Result::SEND_ERROR' */
+    m_error_handler( ::boost::asio::error::no_buffer_space );
+}
+
+::std::size_t OutQueue::frameSize( const OutFrame& frame ) const
+{
+    return frame.size() + 
+        ( m_framing == Framing::LENGTH_PREFIX ? sizeof( FrameHeader ) : 0 );
+}
+
+bool OutQueue::isFull( ::std::size_t size ) const
+{
+    return ( m_watermarks.m_high_bytes != 0 && 
+            m_queued_bytes + size > m_watermarks.m_high_bytes ) ||
+        ( m_watermarks.m_high_frames != 0 && 
+            m_queued_frames + 1 > m_watermarks.m_high_frames );
+}
+
+bool OutQueue::isRelieved() const
+{
+    return ( m_watermarks.m_high_bytes == 0 || m_queued_bytes <= m_watermarks.m_low_bytes ) &&
+        ( m_watermarks.m_high_frames == 0 || m_queued_frames <= m_watermarks.m_low_frames );
+}
+
+/* Frames of the write in flight stay, so do service frames and partly written ones.
+ * Lower lanes lose their frames first. */
+void OutQueue::dropOldest( ::std::size_t size )
+{
+    ::std::size_t dropped = 0;
+    auto is_dropped = [ & ]( const OutFrame& frame )
+    {
+        if( ! isFull( size ) || frame.m_offset != 0 ||
+            frame.m_header.m_type != static_cast< ::std::uint16_t >( FrameType::DATA ) )
+        {
+            return false;
+        }
+        m_queued_bytes -= frameSize( frame );
+        m_queued_frames--;
+        dropped++;
+        return true;
+    };
+    for( auto lane = m_lanes.rbegin(); lane != m_lanes.rend(); ++lane )
+    {
+        lane->erase( ::std::remove_if( lane->begin(), lane->end(), is_dropped ), lane->end() );
+    }
+    if( dropped != 0 )
+    {
+        if( m_metrics_ptr )
+        {
+            Metrics::add( m_metrics_ptr->m_overflows, dropped );
+        }
+        ERROR_LOG( "%lu queued frames are dropped.\n", dropped );
+    }
+}
+
+/* EOF */
\ No newline at end of file
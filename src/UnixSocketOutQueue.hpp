@@ -0,0 +1,50 @@
+#ifndef UNIX_SOCKET_OUT_QUEUE_HPP
+#define UNIX_SOCKET_OUT_QUEUE_HPP
+
+#include "UnixSocket.h"
+
+namespace UnixSocket
+{
+
+template< typename Data >
+ConstBufferShPtr makeShared( Data&& data )
+{
+    using Type = ::std::decay_t< Data >;
+    if constexpr( ::std::is_same< Type, ConstBufferShPtr >::value || 
+                  ::std::is_same< Type, BufferShPtr >::value )
+    { /* Already owned */
+        return ::std::forward<Data>(data);
+    }
+    else if constexpr( ::std::is_same< Type, Buffer >::value && 
+                       ! ::std::is_lvalue_reference< Data >::value )
+    { /* Temporary string is moved, no copy */
+        return ::std::make_shared< const Buffer >( ::std::move( data ) );
+    }
+    else if constexpr( ::std::is_convertible< Data, ::std::string_view >::value )
+    { /* Literals and views of the envelope */
+        ::std::string_view view( data );
+        return ::std::make_shared< const Buffer >( view.data(), view.size() );
+    }
+    else if constexpr( IsMessage< Type >::value )
+    { /* Typed message is encoded right into the payload */
+        return encodeMessage( data );
+    }
+    else
+    {
+        return ::std::make_shared< const Buffer >( 
+            reinterpret_cast< const char * >( data.data() ), data.size() );
+    }
+}
+
+template< typename... Data >
+Chunks makeChunks( Data&&... data )
+{
+    Chunks chunks;
+    chunks.reserve( sizeof...( Data ) );
+    ( chunks.emplace_back( makeShared( ::std::forward<Data>(data) ) ), ... );
+    return chunks;
+}
+
+}
+
+#endif /* UNIX_SOCKET_OUT_QUEUE_HPP */
\ No newline at end of file
@@ -0,0 +1,170 @@
+#include "UnixSocket.h"
+
+using namespace UnixSocket;
+
+/*-----------------*/
+/*--- RpcClient ---*/
+/*-----------------*/
+Result RpcClient::setConfig( Config&& cfg )
+{
+    m_config = cfg;
+    Client::Config& client_config = m_config.m_client;
+    if( client_config.m_framing == Framing::DELIMITER )
+    {
+        ERROR_LOG( "RPC needs length prefixed or packet framing.\n" );
+        return Result::CFG_ERROR;
+    }
+    client_config.m_recv_view_cb = ::std::bind( &RpcClient::received, this, ::std::placeholders::_2 );
+    client_config.m_recv_cb = nullptr;
+    client_config.m_recv_batch_cb = nullptr;
+    client_config.m_recv_fds_cb = nullptr;
+    if( ! client_config.m_send_cb )
+    {
+        client_config.m_send_cb = []( const ClientId&, ::std::size_t ){};
+    }
+    Client::Config copy = client_config;
+    return m_client.setConfig( ::std::move( copy ) );
+}
+
+Result RpcClient::start()
+{
+    return m_client.start();
+}
+
+/* Call is registered before the request is sent : reply can't come before its call */
+Result RpcClient::send( CallId call_id, Buffer&& request, ReplyHandler handler, 
+    ::std::chrono::milliseconds timeout )
+{
+    if( timeout.count() == 0 )
+    {
+        timeout = m_config.m_timeout;
+    }
+    {
+        ::std::lock_guard< ::std::mutex > lock( m_mtx );
+        Call& call = m_calls[ call_id ];
+        call.m_handler = ::std::move( handler );
+        if( timeout.count() != 0 )
+        {
+            call.m_timer = ::std::make_unique< ::boost::asio::steady_timer >( 
+                m_client.m_io_service, timeout );
+            call.m_timer->async_wait( [ this, call_id ]( const ErrCode& error )
+            {
+                if( error )
+                {
+                    return; /* Reply came first */
+                }
+                ::std::string no_reply;
+                complete( call_id, Result::TIMED_OUT, no_reply );
+            } );
+        }
+    }
+    Result result = m_client.send( ::std::move( request ) );
+    if( result != Result::SEND_SUCCESS )
+    {
+        Call call; /* Timer is cancelled outside the lock : its handler takes it */
+        ::std::lock_guard< ::std::mutex > lock( m_mtx );
+        auto it = m_calls.find( call_id );
+        if( it == m_calls.end() )
+        { /* Timed out during the send, handler is called already */
+            return Result::TIMED_OUT;
+        }
+        call = ::std::move( it->second );
+        m_calls.erase( it );
+    }
+    return result;
+}
+
+void RpcClient::received( const Frame& frame )
+{
+    if( frame.m_size < sizeof( RpcHeader ) )
+    {
+        ERROR_LOG( "Reply without RPC header.\n" );
+        return;
+    }
+    RpcHeader header;
+    ::std::memcpy( & header, frame.m_data, sizeof( header ) );
+    m_reply_buf.assign( frame.m_data + sizeof( header ), frame.m_size - sizeof( header ) );
+    complete( header.m_call_id, Result::ALL_GOOD, m_reply_buf );
+}
+
+/* Executed by the I/O thread : reply and timeout never race */
+void RpcClient::complete( CallId call_id, Result result, ::std::string& reply )
+{
+    Call call;
+    {
+        ::std::lock_guard< ::std::mutex > lock( m_mtx );
+        auto it = m_calls.find( call_id );
+        if( it == m_calls.end() )
+        {
+            if( result == Result::ALL_GOOD )
+            {
+                ERROR_LOG( "Reply to the call #%lu came too late.\n", call_id );
+            }
+            return;
+        }
+        call = ::std::move( it->second );
+        m_calls.erase( it );
+    }
+    call.m_handler( result, reply );
+}
+
+RpcClient::~RpcClient()
+{
+    /* Timers are destroyed with 'm_calls' while their 'io_service' is still there */
+    m_client.stop();
+}
+
+/*-----------------*/
+/*--- RpcServer ---*/
+/*-----------------*/
+Result RpcServer::setConfig( Config&& cfg )
+{
+    m_config = cfg;
+    Server::Config& server_config = m_config.m_server;
+    if( server_config.m_framing == Framing::DELIMITER )
+    {
+        ERROR_LOG( "RPC needs length prefixed or packet framing.\n" );
+        return Result::CFG_ERROR;
+    }
+    if( ! m_config.m_request_cb )
+    {
+        ERROR_LOG( "No REQUEST callback provided.\n" );
+        return Result::CFG_ERROR;
+    }
+    /* Reply goes to the connection of the request, so handles are used */
+    server_config.m_recv_handle_cb = ::std::bind( &RpcServer::received, this, 
+        ::std::placeholders::_1, ::std::placeholders::_2 );
+    server_config.m_recv_view_cb = nullptr;
+    server_config.m_recv_batch_cb = nullptr;
+    server_config.m_recv_fds_cb = nullptr;
+    if( ! server_config.m_send_cb && ! server_config.m_send_handle_cb )
+    {
+        server_config.m_send_cb = []( const ClientId&, ::std::size_t ){};
+    }
+    if( ! server_config.m_error_cb && ! server_config.m_error_handle_cb )
+    {
+        server_config.m_error_cb = []( const ClientId&, const ErrorDescription& ){};
+    }
+    Server::Config copy = server_config;
+    return m_server.setConfig( ::std::move( copy ) );
+}
+
+Result RpcServer::start()
+{
+    return m_server.start();
+}
+
+void RpcServer::received( ClientHandle handle, ::std::string& request )
+{
+    if( request.size() < sizeof( RpcHeader ) )
+    {
+        ERROR_LOG( "Request without RPC header.\n" );
+        return;
+    }
+    RpcHeader header;
+    ::std::memcpy( & header, request.data(), sizeof( header ) );
+    request.erase( 0, sizeof( header ) );
+    m_config.m_request_cb( handle, request, Reply( & m_server, handle, header.m_call_id ) );
+}
+
+/* EOF */
\ No newline at end of file
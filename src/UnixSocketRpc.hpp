@@ -0,0 +1,60 @@
+#ifndef UNIX_SOCKET_RPC_HPP
+#define UNIX_SOCKET_RPC_HPP
+
+#include "UnixSocket.h"
+
+namespace UnixSocket
+{
+
+template< typename Data >
+Buffer makeRpcFrame( CallId call_id, const Data& data )
+{
+    RpcHeader header{ call_id };
+    Buffer frame;
+    frame.reserve( sizeof( header ) + data.size() );
+    frame.append( reinterpret_cast< const char * >( & header ), sizeof( header ) );
+    frame.append( reinterpret_cast< const char * >( data.data() ), data.size() );
+    return frame;
+}
+
+template< typename Data >
+Result RpcClient::call( Data&& request, ReplyHandler handler, 
+    ::std::chrono::milliseconds timeout )
+{
+    CallId call_id = m_next_id.fetch_add( 1 );
+    return send( call_id, makeRpcFrame( call_id, request ), ::std::move( handler ), timeout );
+}
+
+template< typename Data >
+::std::future< ::std::string > RpcClient::call( Data&& request )
+{
+    auto promise = ::std::make_shared< ::std::promise< ::std::string > >();
+    ::std::future< ::std::string > future = promise->get_future();
+    Result result = call( ::std::forward<Data>(request),
+        [ promise ]( Result result, ::std::string& reply )
+        {
+            if( result == Result::ALL_GOOD )
+            {
+                promise->set_value( ::std::move( reply ) );
+                return;
+            }
+            promise->set_exception( ::std::make_exception_ptr( 
+                ::std::runtime_error( "No reply in time." ) ) );
+        } );
+    if( result != Result::SEND_SUCCESS && result != Result::TIMED_OUT ) /* Handler isn't called */
+    {
+        promise->set_exception( ::std::make_exception_ptr( 
+            ::std::runtime_error( "Request isn't sent." ) ) );
+    }
+    return future;
+}
+
+template< typename Data >
+Result RpcServer::Reply::operator()( Data&& data ) const
+{
+    return m_server_ptr->send( m_handle, makeRpcFrame( m_call_id, data ) );
+}
+
+}
+
+#endif /* UNIX_SOCKET_RPC_HPP */
\ No newline at end of file
@@ -1,33 +1,52 @@
 #include "UnixSocket.h"
 
+#include <algorithm>
+
 using namespace UnixSocket;
 
 Result Server::setConfig( Config&& cfg )
 {
     m_config = cfg;
     ERR_CHECK( m_config.m_address,      "file name" );
-    ERR_CHECK( m_config.m_id_key,       "identification");
-    ERR_CHECK( m_config.m_delimiter,    "delimiter");
+    if( m_config.m_handshake == Handshake::XML )
+    {
+        ERR_CHECK( m_config.m_id_key,       "identification");
+    }
+    if( m_config.m_framing == Framing::DELIMITER )
+    {
+        ERR_CHECK( m_config.m_delimiter,    "delimiter");
+    }
+    if( m_config.m_framing == Framing::PACKET && m_config.m_transport != Transport::SEQPACKET )
+    {
+        ERROR_LOG( "Packet framing needs seqpacket transport.\n" );
+        return Result::CFG_ERROR;
+    }
 
-    if( ! m_config.m_recv_cb )
+    if( m_config.m_allow_shm && ( ! m_config.m_pass_fds || 
+        m_config.m_framing != Framing::LENGTH_PREFIX ) )
+    {
+        ERROR_LOG( "Shared memory needs length prefixed framing and passing of descriptors.\n" );
+        return Result::CFG_ERROR;
+    }
+    if( ! m_config.m_recv_cb && ! m_config.m_recv_handle_cb && ! m_config.m_recv_view_cb )
     {
-        PRINT_ERR( "No RECEIVE callback provided.\n" );
+        ERROR_LOG( "No RECEIVE callback provided.\n" );
         return Result::CFG_ERROR;
     }
-    if( ! m_config.m_send_cb )
+    if( ! m_config.m_send_cb && ! m_config.m_send_handle_cb )
     {
-        PRINT_ERR( "No SEND callback provided.\n" );
+        ERROR_LOG( "No SEND callback provided.\n" );
         return Result::CFG_ERROR;
     }
-    if( ! m_config.m_error_cb )
+    if( ! m_config.m_error_cb && ! m_config.m_error_handle_cb )
     {
-        PRINT_ERR( "No ERROR callback provided.\n" );
+        ERROR_LOG( "No ERROR callback provided.\n" );
         return Result::CFG_ERROR;
     }
 
     unlink( m_config.m_address.c_str() ); //prepare address upfront
     m_is_configured.store( true );
-    PRINTF( GRN, "Configuration is accepted.\n" );
+    INFO_LOG( GRN, "Configuration is accepted.\n" );
     return Result::ALL_GOOD;
 }
 
@@ -35,83 +54,274 @@ Result Server::start()
 {
     if( ! m_is_configured.load() )
     {
-        PRINT_ERR( "Server has no configuration.\n" );
+        ERROR_LOG( "Server has no configuration.\n" );
         return Result::CFG_ERROR;
     }
-    ::std::cout << "Starting Unix server : " << m_config.m_address <<::std::endl;
-    // PRINTF( RED, "Starting Unix server '%s'", m_config.m_address.c_str() );
-    m_acceptor_uptr = ::std::make_unique< Acceptor >( m_io_service , EndPoint{ m_config.m_address } );
+    INFO_LOG( GRN, "Starting Unix server : %s.\n", m_config.m_address.c_str() );
+    m_started_at = StatsClock::now();
+    m_io_pool.start( m_config.m_io_threads, m_config.m_balance );
+    /* Endpoint alone doesn't know the socket type */
+    m_acceptor_uptr = ::std::make_unique< Acceptor >( m_io_pool.get( 0 ) );
+    m_acceptor_uptr->open( Protocol( m_config.m_transport ) );
+    m_acceptor_uptr->bind( EndPoint{ m_config.m_address } );
+    m_acceptor_uptr->listen();
     accept(); /* Recursive async call inside */
-    auto work = [&](){
-        m_io_service.run();
-    }; //end []
-
-#ifdef THREAD_IMPLEMENTATION
-    m_worker = ::std::move( ::std::thread( work ) );
-#else
-    m_future = ::std::async( work );
-#endif
     return Result::ALL_GOOD;
 }
 
 void Server::accept ()
 {
-    SessionHandle session_handle = m_sessions.emplace( m_sessions.end(), m_io_service, this  );
-    m_acceptor_uptr->async_accept( session_handle->m_socket,
-        [&, session_handle ] ( const ErrCode& error ) //mutable
+    IoPool::Index io_index = m_io_pool.acquire();
+    SessionShPtr session = ::std::make_shared< Session >( 
+        m_io_pool.get( io_index ), io_index, this );
+    m_acceptor_uptr->async_accept( session->m_socket,
+        [ this, session ] ( const ErrCode& error )
         {
             if ( !error )
             {
-                PRINTF( GRN, "Client accepted.\n" );
-                session_handle->saveHandle( session_handle );
-                session_handle->m_is_accepted.store( true );
-                session_handle->recv();
+                DEBUG_LOG( GRN, "Client accepted.\n" );
+                m_accepted.fetch_add( 1, ::std::memory_order_relaxed );
+                session->m_accepted_at = StatsClock::now();
+                session->start();
+                m_sessions.insert( session.get(), session );
+                session->m_is_accepted.store( true );
+                /* From now on session is served by its own I/O thread */
+                session->m_io_service_ref.post( 
+                    ::std::bind( &Session::recv, session ) );
                 this->accept();
             }
             else
             {
-                PRINT_ERR( "Error when accepting : %s\n", error.message().c_str() );
+                m_accept_errors.fetch_add( 1, ::std::memory_order_relaxed );
+                ERROR_LOG( "Error when accepting : %s\n", error.message().c_str() );
             }
         } );
 }
 
-void Server::removeSession( SessionHandle& session )
+void Server::removeSession( const SessionShPtr& session )
 {
-    PRINTF( RED, "Removing session with client '%s'\n", \
+    DEBUG_LOG( RED, "Removing session with client '%s'\n", \
         session->m_client_id.c_str() );
-    ::std::unique_lock< ::std::mutex >( m_sessions_mtx );
-    if( session->m_is_identified.load() )
+    GroupShPtr group = session->m_group.lock();
+    if( group )
     {
-        auto iter = m_id_sessions_map.find( session->m_client_id );
-        if( iter == m_id_sessions_map.end() )
+        if( group->leave( session.get() ) )
+        {
+            m_groups.erase( session->m_client_id, group );
+        }
+    }
+    else if( session->m_is_identified.load() &&
+        ! m_id_sessions_map.erase( session->m_client_id, session ) )
+    {
+        ERROR_LOG( "Can't find session with client : %s\n", \
+            session->m_client_id.c_str() );
+    }
+    m_handles.erase( session->m_handle );
+    m_sessions.erase( session.get(), session );
+    /* Memory is freed when the last pending handler is done */
+    session->close();
+}
+
+bool Server::joinGroup( const SessionShPtr& session )
+{
+    if( m_id_sessions_map.find( session->m_client_id ) )
+    {
+        return false; /* Name is taken by the single client */
+    }
+    while( true )
+    {
+        GroupShPtr group = m_groups.find( session->m_client_id );
+        if( ! group )
+        {
+            group = ::std::make_shared< Group >();
+            if( ! m_groups.insert( session->m_client_id, group ) )
+            {
+                continue; /* Other member was first */
+            }
+        }
+        if( group->join( session ) )
         {
-            PRINT_ERR( "Can't find session with client : %s\n", \
-                session->m_client_id.c_str() );
-            return;
+            session->m_group = group;
+            return true;
         }
-        m_id_sessions_map.erase(iter);
+        /* Last member has just left, group is replaced with the new one */
+        m_groups.erase( session->m_client_id, group );
+    }
+}
+
+Server::SessionShPtr Server::findClient( const ClientId& client_name )
+{
+    SessionShPtr session = m_id_sessions_map.find( client_name );
+    if( ! session )
+    {
+        GroupShPtr group = m_groups.find( client_name );
+        session = group ? group->pick() : nullptr;
     }
-    m_sessions.erase( session );
+    return session;
+}
+
+Server::SessionShPtr Server::findClient( const ClientId& client_name, OrderKey key )
+{
+    GroupShPtr group = m_groups.find( client_name );
+    return group ? group->pick( key ) : m_id_sessions_map.find( client_name );
+}
+
+Result Server::sendChunks( const ::std::string& client_name, Chunks&& chunks )
+{
+    SessionShPtr session = findClient( client_name );
+    if( ! session )
+    {
+        ERROR_LOG( "No such client : %s.\n", client_name.c_str() );
+        return Result::NO_SUCH_ADDRESS;
+    }
+    Result result = session->push( makeFrame( ::std::move( chunks ) ) );
+    return ( result == Result::ALL_GOOD ) ? Result::SEND_SUCCESS : result;
+}
+
+Result Server::sendChunks( ClientHandle handle, Chunks&& chunks )
+{
+    SessionShPtr session = m_handles.find( handle );
+    if( ! session )
+    {
+        ERROR_LOG( "No such client handle : %lu.\n", handle );
+        return Result::NO_SUCH_ADDRESS;
+    }
+    Result result = session->push( makeFrame( ::std::move( chunks ) ) );
+    return ( result == Result::ALL_GOOD ) ? Result::SEND_SUCCESS : result;
+}
+
+ClientHandle Server::handleOf( const ClientId& client_name )
+{
+    SessionShPtr session = findClient( client_name );
+    return session ? session->m_handle : INVALID_HANDLE;
+}
+
+ClientId Server::nameOf( ClientHandle handle )
+{
+    SessionShPtr session = m_handles.find( handle );
+    return session ? session->m_client_id : ClientId{};
+}
+
+Server::Stats Server::stats()
+{
+    Stats stats;
+    if( m_started_at != StatsClock::time_point{} )
+    {
+        stats.m_uptime = ::std::chrono::duration_cast< ::std::chrono::milliseconds >( 
+            StatsClock::now() - m_started_at );
+    }
+    stats.m_accepted = m_accepted.load( ::std::memory_order_relaxed );
+    if( stats.m_uptime.count() != 0 )
+    {
+        stats.m_accept_rate = 1000.0 * stats.m_accepted / stats.m_uptime.count();
+    }
+    stats.m_accept_errors = m_accept_errors.load( ::std::memory_order_relaxed );
+    stats.m_rejected = m_rejected.load( ::std::memory_order_relaxed );
+    stats.m_read_errors = m_read_errors.load( ::std::memory_order_relaxed );
+    stats.m_write_errors = m_write_errors.load( ::std::memory_order_relaxed );
+    stats.m_identification = m_identification.snapshot();
+    /* Sessions are snapshotted out of the registry's locks */
+    ::std::vector< SessionShPtr > sessions;
+    sessions.reserve( m_sessions.size() );
+    m_sessions.forEach( [ & ]( const Session *, const SessionShPtr& session )
+        {
+            sessions.push_back( session );
+        } );
+    stats.m_sessions.reserve( sessions.size() );
+    for( const SessionShPtr& session : sessions )
+    {
+        stats.m_sessions.emplace_back( session->stats() );
+    }
+    return stats;
+}
+
+Result Server::sendAll( const ::std::vector< SessionShPtr >& sessions, 
+    const ConstBufferShPtr& payload )
+{
+    ::std::size_t blocked = 0;
+    ::std::size_t failed = 0;
+    for( const SessionShPtr& session : sessions )
+    {
+        Result result = session->send( payload );
+        blocked += ( result == Result::WOULD_BLOCK ) ? 1 : 0;
+        failed += ( result != Result::ALL_GOOD && result != Result::WOULD_BLOCK ) ? 1 : 0;
+    }
+    if( failed != 0 || blocked != 0 )
+    {
+        ERROR_LOG( "Data isn't sent to %lu of %lu clients, %lu of them would block.\n", 
+            failed + blocked, sessions.size(), blocked );
+    }
+    return ( failed != 0 ) ? Result::SEND_ERROR : 
+        ( blocked != 0 ) ? Result::WOULD_BLOCK : Result::SEND_SUCCESS;
 }
 
 Server::~Server()
 {
+    /* Stop handling events, all I/O threads are joined after this */
+    m_io_pool.stop();
+
     /* Stop accepting */
-    m_acceptor_uptr->cancel();
-    m_acceptor_uptr->close();
+    if( m_acceptor_uptr )
+    {
+        m_acceptor_uptr->cancel();
+        m_acceptor_uptr->close();
+        m_acceptor_uptr.reset(); /* Before its 'io_service' */
+    }
     
-    {/* Destroy all sessions */
-        ::std::unique_lock< ::std::mutex >( m_sessions_mtx );
-        m_sessions.clear();
-    }
-    /* Stop handling events */
-    m_io_service.stop();
-#ifdef THREAD_IMPLEMENTATION
-    m_worker.join();
-#else
-    m_future.get();
-#endif
-    PRINTF( YEL, "Server destroyed.\n" );
+    /* Destroy all sessions, the ones held by pending handlers
+     * go with the 'io_service's */
+    m_id_sessions_map.clear();
+    m_groups.clear();
+    m_handles.clear();
+    m_sessions.clear();
+    INFO_LOG( YEL, "Server destroyed.\n" );
+}
+
+/*-------------*/
+/*--- Group ---*/
+/*-------------*/
+bool Server::Group::join( const SessionShPtr& session )
+{
+    ::std::unique_lock< ::std::shared_mutex > lock( m_mtx );
+    if( m_is_closed )
+    {
+        return false;
+    }
+    m_members.emplace_back( session );
+    return true;
+}
+
+bool Server::Group::leave( const Session * session )
+{
+    ::std::unique_lock< ::std::shared_mutex > lock( m_mtx );
+    auto it = ::std::find_if( m_members.begin(), m_members.end(), 
+        [ session ]( const SessionShPtr& member ){ return member.get() == session; } );
+    if( it != m_members.end() )
+    {
+        m_members.erase( it );
+    }
+    m_is_closed = m_members.empty();
+    return m_is_closed;
+}
+
+Server::SessionShPtr Server::Group::pick()
+{
+    ::std::shared_lock< ::std::shared_mutex > lock( m_mtx );
+    if( m_members.empty() )
+    {
+        return nullptr;
+    }
+    return m_members[ m_next.fetch_add( 1, ::std::memory_order_relaxed ) % m_members.size() ];
+}
+
+Server::SessionShPtr Server::Group::pick( OrderKey key )
+{
+    ::std::shared_lock< ::std::shared_mutex > lock( m_mtx );
+    if( m_members.empty() )
+    {
+        return nullptr;
+    }
+    return m_members[ key % m_members.size() ];
 }
 
 /* EOF */
\ No newline at end of file
@@ -10,43 +10,134 @@ namespace UnixSocket
 template< typename Data >
 Result Server::send( const ::std::string& client_name, Data&& data )
 {
-    ::std::unique_lock< ::std::mutex >( m_sessions_mtx );
+    return send( client_name, Priority::NORMAL, ::std::forward<Data>(data) );
+}
+
+template< typename Data >
+Result Server::send( ClientHandle handle, Data&& data )
+{
+    return send( handle, Priority::NORMAL, ::std::forward<Data>(data) );
+}
+
+template< typename Data >
+Result Server::send( const ::std::string& client_name, Priority priority, Data&& data )
+{
     /* Client should provide some kind recognition. */
-    auto found = m_id_sessions_map.find( client_name );
-    if( found != m_id_sessions_map.end() )
-    {
-        /* Underlaying class is Session */
-        found->second->send(::std::forward<Data>(data) );
-        return Result::SEND_SUCCESS;
+    SessionShPtr session = findClient( client_name );
+    if( session )
+    { /* Session stays alive while it's used, even if it's removed meanwhile */
+        Result result = session->send( ::std::forward<Data>(data), Fds{}, priority );
+        return ( result == Result::ALL_GOOD ) ? Result::SEND_SUCCESS : result;
     }
     else
     {
-        PRINT_ERR( "No such client : %s.\n", client_name.c_str() );
+        ERROR_LOG( "No such client : %s.\n", client_name.c_str() );
         return Result::NO_SUCH_ADDRESS;
     }
 }
 
 template< typename Data >
-Result Server::multiCast( Data&& data )
+Result Server::send( ClientHandle handle, Priority priority, Data&& data )
 {
-    ::std::unique_lock< ::std::mutex >( m_sessions_mtx );
-    for( auto& it : m_id_sessions_map )
+    SessionShPtr session = m_handles.find( handle );
+    if( ! session )
     {
-        it.second->send( ::std::forward<Data>(data) );
+        ERROR_LOG( "No such client handle : %lu.\n", handle );
+        return Result::NO_SUCH_ADDRESS;
     }
-    return Result::SEND_SUCCESS;
+    Result result = session->send( ::std::forward<Data>(data), Fds{}, priority );
+    return ( result == Result::ALL_GOOD ) ? Result::SEND_SUCCESS : result;
 }
 
 template< typename Data >
-Result Server::broadCast( Data&& data )
+Result Server::send( const ::std::string& client_name, OrderKey key, Data&& data )
 {
-    ::std::unique_lock< ::std::mutex >( m_sessions_mtx );
-    for( auto& it : m_sessions )
+    SessionShPtr session = findClient( client_name, key );
+    if( ! session )
     {
-        if( it.m_is_accepted.load() )
-            it.send( ::std::forward<Data>(data) );
+        ERROR_LOG( "No such client : %s.\n", client_name.c_str() );
+        return Result::NO_SUCH_ADDRESS;
+    }
+    Result result = session->send( ::std::forward<Data>(data) );
+    return ( result == Result::ALL_GOOD ) ? Result::SEND_SUCCESS : result;
+}
+
+template< typename Data >
+Result Server::sendFds( const ::std::string& client_name, Data&& data, 
+    const ::std::vector< int >& fds )
+{
+    SessionShPtr session = findClient( client_name );
+    if( ! session )
+    {
+        ERROR_LOG( "No such client : %s.\n", client_name.c_str() );
+        return Result::NO_SUCH_ADDRESS;
     }
-    return Result::SEND_SUCCESS;
+    return sendFds( session, ::std::forward<Data>(data), fds );
+}
+
+template< typename Data >
+Result Server::sendFds( ClientHandle handle, Data&& data, const ::std::vector< int >& fds )
+{
+    SessionShPtr session = m_handles.find( handle );
+    if( ! session )
+    {
+        ERROR_LOG( "No such client handle : %lu.\n", handle );
+        return Result::NO_SUCH_ADDRESS;
+    }
+    return sendFds( session, ::std::forward<Data>(data), fds );
+}
+
+template< typename Data >
+Result Server::sendFds( const SessionShPtr& session, Data&& data, 
+    const ::std::vector< int >& fds )
+{
+    if( m_config.m_framing != Framing::LENGTH_PREFIX )
+    {
+        ERROR_LOG( "Descriptors can be passed only with length prefixed framing.\n" );
+        return Result::CFG_ERROR;
+    }
+    Fds dup_fds;
+    if( dupFds( fds, dup_fds ) != Result::ALL_GOOD )
+    {
+        return Result::SEND_ERROR;
+    }
+    Result result = session->send( ::std::forward<Data>(data), ::std::move( dup_fds ) );
+    return ( result == Result::ALL_GOOD ) ? Result::SEND_SUCCESS : result;
+}
+
+/* Payload is wrapped once and shared by the queues of all sessions */
+template< typename Data >
+Result Server::multiCast( Data&& data )
+{
+    ConstBufferShPtr payload = makeShared( ::std::forward<Data>(data) );
+    /* Sessions are sent to out of the registry's locks : 'Overflow::BLOCK' may wait */
+    ::std::vector< SessionShPtr > sessions;
+    sessions.reserve( m_id_sessions_map.size() + m_groups.size() );
+    m_id_sessions_map.forEach( [ & ]( const ClientId&, const SessionShPtr& session )
+    {
+        sessions.push_back( session );
+    } );
+    m_groups.forEach( [ & ]( const ClientId&, const GroupShPtr& group )
+    { /* Group is one client */
+        SessionShPtr session = group->pick();
+        if( session )
+            sessions.push_back( ::std::move( session ) );
+    } );
+    return sendAll( sessions, payload );
+}
+
+template< typename Data >
+Result Server::broadCast( Data&& data )
+{
+    ConstBufferShPtr payload = makeShared( ::std::forward<Data>(data) );
+    ::std::vector< SessionShPtr > sessions;
+    sessions.reserve( m_sessions.size() );
+    m_sessions.forEach( [ & ]( const Session *, const SessionShPtr& session )
+    {
+        if( session->m_is_accepted.load() )
+            sessions.push_back( session );
+    } );
+    return sendAll( sessions, payload );
 }
 
 
@@ -2,93 +2,384 @@
 
 using namespace UnixSocket;
 
-void Server::Session::recv()
+Server::Session::Session( IoService& io_service, IoPool::Index io_index, Server * parent )
+    : m_io_service_ref( io_service ),
+    m_io_index( io_index ),
+    m_socket( io_service ),
+    m_parent_ptr( parent ),
+    m_end_tag( "</" + parent->getConfig().m_delimiter + ">" ),
+    m_id_tag( "</" + parent->getConfig().m_id_key + ">" )
 {
-    ::std::string delimiter = "";
-    if( ! m_is_identified.load() )
+    if( m_parent_ptr->getConfig().m_allow_shm )
     {
-        delimiter = ::std::string{ "</" + m_parent_ptr->getConfig().m_id_key + ">" };
+        m_shm_uptr = ::std::make_unique< ShmChannel >( io_service,
+            ::std::bind( &Session::deliver, this, ::std::placeholders::_1 ),
+            ::std::bind( &Session::flushBatch, this ),
+            ::std::bind( &Session::notifySent, this, ::std::placeholders::_1 ) );
     }
-    else
+}
+
+void Server::Session::start()
+{
+    m_out_queue.measure( m_metrics );
+    m_out_queue.start( m_socket, m_parent_ptr->getConfig().m_transport,
+        m_parent_ptr->getConfig().m_framing,
+        [ this ]( ::std::size_t bytes_transferred )
+        {
+            notifySent( bytes_transferred );
+            TRACE_LOG( GRN, "%lu bytes is sent.\n", bytes_transferred );
+        },
+        ::std::bind( &Session::writeError, this, ::std::placeholders::_1 ),
+        shared_from_this() );
+    const Config& config = m_parent_ptr->getConfig();
+    m_out_queue.limit( config.m_watermarks, [ this ]( bool is_high )
+        {
+            if( m_parent_ptr->getConfig().m_watermark_cb )
+            {
+                m_parent_ptr->getConfig().m_watermark_cb( m_client_id, is_high );
+            }
+        } );
+    if( m_shm_uptr )
     {
-        delimiter = ::std::string{ "</" + m_parent_ptr->getConfig().m_delimiter + ">" };
+        m_shm_uptr->limit( config.m_watermarks.m_high_bytes );
+        m_shm_uptr->measure( m_metrics );
+        m_shm_uptr->attach( shared_from_this() );
     }
+}
 
-    /* Usage of static buffer is abandoned in favour of multithread implementation */
-    // m_read_buf.clear();
-    // m_read_buf.reserve( READ_BUF_SIZE );
-
-    BufferShPtr read_buf_shptr = ::std::make_shared< Buffer >();
-    read_buf_shptr->reserve( READ_BUF_SIZE );
-
-    ::boost::asio::async_read_until( m_socket,
-    ::boost::asio::dynamic_buffer( * read_buf_shptr ),
-    delimiter,
-    [ &, read_buf_shptr ] ( const ErrCode& error, 
-        ::std::size_t bytes_transferred ) //mutable
+void Server::Session::close()
+{
+    ErrCode ignored;
+    m_socket.close( ignored );
+    if( m_shm_uptr )
     {
-        if( error )
+        m_shm_uptr->close();
+    }
+}
+
+void Server::Session::recv()
+{
+    const Config& config = m_parent_ptr->getConfig();
+    if( config.m_pass_fds || config.m_transport == Transport::SEQPACKET )
+    { /* Plain read drops ancillary data and can't detect truncated packets,
+       * so 'recvmsg' is used when socket is ready */
+        m_socket.async_wait( Socket::wait_read,
+        [ this, self = shared_from_this() ] ( const ErrCode& error )
         {
-            PRINT_ERR( "Error when reading : %s\n", error.message().c_str());
-            if( m_socket.is_open() )
+            ErrCode read_error = error;
+            ::std::size_t bytes_transferred = 0;
+            if( ! read_error )
+            {
+                bytes_transferred = recvWithFds( m_socket, m_read_buf.prepare( ::std::max< ::std::size_t >( 
+                    READ_BUF_SIZE, m_parent_ptr->getConfig().m_max_packet ) ), m_fds, read_error );
+            }
+            if( read_error == ::boost::asio::error::would_block ||
+                read_error == ::boost::asio::error::try_again )
+            {
+                this->recv();
+                return;
+            }
+            if( read_error )
             {
-               m_socket.shutdown( Socket::shutdown_receive );
+                readError( read_error );
+                return;
             }
-            m_parent_ptr->getConfig().m_error_cb( m_client_id, error.message().c_str() );
-            m_is_valid.store( false );
-            m_io_service_ref.post( \
-                ::std::bind( &Server::removeSession, m_parent_ptr, m_self) );
+            received( bytes_transferred );
+        } ); //end async_wait
+        return;
+    }
+    m_socket.async_read_some( m_read_buf.prepare( READ_BUF_SIZE ),
+    [ this, self = shared_from_this() ] ( const ErrCode& error, ::std::size_t bytes_transferred )
+    {
+        if( error )
+        {
+            readError( error );
             return;
         } //end if( error )
+        received( bytes_transferred );
+    } ); //end async_read_some
+}
 
-        if( ! m_is_identified.load() )
-        {
-            identification( * read_buf_shptr );
-        } else { /* Give access to data after identification. */
-            m_parent_ptr->getConfig().m_recv_cb( m_client_id, * read_buf_shptr );
-        } //end if
+void Server::Session::received( ::std::size_t bytes_transferred )
+{
+    m_read_buf.commit( bytes_transferred );
+
+    /* Deliver every complete frame, the rest waits for the next read */
+    const Config& config = m_parent_ptr->getConfig();
+    /* Binary handshake is length prefixed whatever the framing is */
+    const Framing id_framing = ( config.m_handshake == Handshake::BINARY ) ?
+        Framing::LENGTH_PREFIX : config.m_framing;
+    Frame frame;
+    while( m_is_valid.load() && m_read_buf.next( 
+        m_is_identified.load() ? config.m_framing : id_framing,
+        m_is_identified.load() ? m_end_tag : m_id_tag, frame ) )
+    {
+        deliver( frame );
+    }
+    flushBatch();
+    if( m_is_valid.load() ) /* Rejected session isn't read anymore */
+    {
         this->recv();
-    } ); //end async_read_until
+    }
+}
+
+void Server::Session::flushBatch()
+{
+    if( m_batch_len != 0 )
+    {
+        m_batch.resize( m_batch_len );
+        m_parent_ptr->getConfig().m_recv_batch_cb( m_client_id, m_batch );
+        m_batch_len = 0;
+    }
+}
+
+void Server::Session::deliver( const Frame& frame )
+{
+    const Config& config = m_parent_ptr->getConfig();
+    Metrics::add( m_metrics.m_frames_in );
+    Metrics::add( m_metrics.m_bytes_in, frame.m_size );
+    /* Descriptors arrive in the same order as frames they belong to */
+    for( ::std::size_t idx = fdsNumber( frame.m_header ); idx != 0 && ! m_fds.empty(); idx-- )
+    {
+        m_frame_fds.emplace_back( ::std::move( m_fds.front() ) );
+        m_fds.pop_front();
+    }
+    if( ! m_is_identified.load() )
+    {
+        if( identification( frame ) != Result::ID_SUCCESS )
+        {
+            m_parent_ptr->m_rejected.fetch_add( 1, ::std::memory_order_relaxed );
+            readError( ::boost::asio::error::access_denied );
+        }
+    } 
+    else if( config.m_framing == Framing::LENGTH_PREFIX && control( frame ) )
+    { /* Service frame, nothing for the user */ }
+    else if( ! m_frame_fds.empty() && config.m_recv_fds_cb )
+    {
+        m_frame_buf.assign( frame.m_data, frame.m_size );
+        config.m_recv_fds_cb( m_client_id, m_frame_buf, m_frame_fds );
+    }
+    else if( config.m_recv_view_cb )
+    {
+        config.m_recv_view_cb( m_client_id, frame );
+    }
+    else if( config.m_recv_batch_cb ) 
+    {
+        if( m_batch_len == m_batch.size() )
+        {
+            m_batch.emplace_back();
+        }
+        /* Strings keep their capacity from previous batches */
+        m_batch[ m_batch_len++ ].assign( frame.m_data, frame.m_size );
+    }
+    else if( config.m_recv_handle_cb )
+    {
+        m_frame_buf.assign( frame.m_data, frame.m_size );
+        config.m_recv_handle_cb( m_handle, m_frame_buf );
+    }
+    else
+    { /* Give access to data after identification. */
+        m_frame_buf.assign( frame.m_data, frame.m_size );
+        config.m_recv_cb( m_client_id, m_frame_buf );
+    } //end if
+    m_frame_fds.clear(); /* Descriptors not taken by user are closed */
+}
+
+bool Server::Session::control( const Frame& frame )
+{
+    switch( static_cast< FrameType >( frame.m_header.m_type ) )
+    {
+        case FrameType::SHM_OFFER :
+        {
+            ::std::uint64_t capacity = 0;
+            if( frame.m_size == sizeof( capacity ) )
+            {
+                ::std::memcpy( & capacity, frame.m_data, sizeof( capacity ) );
+            }
+            bool is_accepted = ( m_shm_uptr && ! m_shm_uptr->isOpen() &&
+                m_shm_uptr->open( m_frame_fds, capacity ) == Result::ALL_GOOD );
+            OutFrame reply{ makeHeader( 0, is_accepted ? 
+                FrameType::SHM_ACCEPT : FrameType::SHM_REJECT ), makeShared( Buffer{} ) };
+            if( is_accepted )
+            { /* From now on data goes through the shared memory */
+                m_shm_uptr->startSending( ::std::move( reply ), m_out_queue );
+                DEBUG_LOG( GRN, "Shared memory with client '%s' is opened.\n", m_client_id.c_str() );
+            }
+            else
+            {
+                m_out_queue.push( ::std::move( reply ) );
+            }
+            return true;
+        }
+        case FrameType::SHM_START :
+        {
+            if( m_shm_uptr && m_shm_uptr->isOpen() )
+            {
+                m_shm_uptr->startReceiving();
+            }
+            return true;
+        }
+        default :
+        {
+            return false;
+        }
+    } //end switch
+}
+
+void Server::Session::readError( const ErrCode& error )
+{
+    if( ! m_is_valid.exchange( false ) )
+    {
+        return; /* Aborted operations of the removed session */
+    }
+    Metrics::add( m_metrics.m_read_errors );
+    m_parent_ptr->m_read_errors.fetch_add( 1, ::std::memory_order_relaxed );
+    ERROR_LOG( "Error when reading : %s\n", error.message().c_str());
+    if( m_socket.is_open() )
+    {
+       ErrCode ignored;
+       m_socket.shutdown( Socket::shutdown_receive, ignored );
+    }
+    notifyError( error.message() );
+    m_io_service_ref.post( \
+        ::std::bind( &Server::removeSession, m_parent_ptr, shared_from_this() ) );
+}
+
+void Server::Session::writeError( const ErrCode& error )
+{
+    if( ! m_is_valid.exchange( false ) )
+    {
+        return; /* Aborted operations of the removed session */
+    }
+    Metrics::add( m_metrics.m_write_errors );
+    m_parent_ptr->m_write_errors.fetch_add( 1, ::std::memory_order_relaxed );
+    ERROR_LOG( "Error when writing : %s\n", error.message().c_str() );
+    if( m_socket.is_open() )
+    {
+        ErrCode ignored;
+        m_socket.shutdown( Socket::shutdown_send, ignored );
+    }
+    notifyError( error.message() );
+    m_io_service_ref.post( \
+        ::std::bind( &Server::removeSession, m_parent_ptr, shared_from_this() ) );
 }
 
-Result Server::Session::identification( const ::std::string& in_data )
+Result Server::Session::identification( const Frame& frame )
 {
-    /* Actual parsing here */
-    Tree xml_tree;
-    // ::std::istringstream xml_stream( in_data ); //needless copy
-    /* Avoids copy : */
-    boost::iostreams::stream< \
-        boost::iostreams::array_source > \
-            xml_stream( in_data.c_str(), in_data.size() );
-    PropTree::read_xml( xml_stream, xml_tree );
-    try {
-        this->m_client_id = xml_tree.get<std::string>( m_parent_ptr->getConfig().m_id_key );
+    const Config& config = m_parent_ptr->getConfig();
+    ::std::uint16_t caps = 0;
+    ClientId client_id = parseIdentification( frame, config.m_handshake, config.m_id_key, caps );
+    if( client_id.empty() )
+    {
+        return Result::ID_FAILURE;
+    }
+    if( ( caps & CAP_FDS ) && ! config.m_pass_fds )
+    {
+        ERROR_LOG( "Client passes descriptors, but server doesn't accept them.\n" );
+    }
+    bool is_member = ( caps & CAP_GROUP ) != 0; //client is one of the group's connections
+    if( caps & CAP_CHUNKS ) /* Before anything is sent to the identified client */
+    {
+        m_out_queue.split( config.m_chunk_size );
+    }
+    if( config.m_peer_check_cb )
+    {
+        ucred cred{};
+        socklen_t cred_len = sizeof( cred );
+        if( ::getsockopt( m_socket.native_handle(), SOL_SOCKET, SO_PEERCRED, 
+                & cred, & cred_len ) != 0 ||
+            ! config.m_peer_check_cb( client_id, PeerCred{ cred.pid, cred.uid, cred.gid } ) )
         {
-            ::std::unique_lock< ::std::mutex >( m_sessions_mtx );
-            m_parent_ptr->getIdentifiedSessions().emplace(
-                ::std::make_pair(
-                    m_client_id, 
-                    m_self
-            ) );
+            ERROR_LOG( "Client '%s' is rejected by peer check.\n", client_id.c_str() );
+            return Result::ID_FAILURE;
         }
-        m_is_identified.store(true);
-        PRINTF( GRN, "Client '%s' successfully identified.\n", m_client_id.c_str() );
-        return Result::ID_SUCCESS;
-    } catch( const ::std::exception& e )
+    }
+    this->m_client_id = ::std::move( client_id );
+    /* Handle is ready before the session can be found by name */
+    m_handle = m_parent_ptr->m_handles.insert( shared_from_this() );
+    if( m_handle == INVALID_HANDLE )
+    {
+        ERROR_LOG( "Too many clients.\n" );
+        return Result::ID_FAILURE;
+    }
+    /* Name belongs either to one client or to the group */
+    bool is_registered = is_member ? m_parent_ptr->joinGroup( shared_from_this() ) :
+        ( ! m_parent_ptr->m_groups.find( m_client_id ) &&
+            m_parent_ptr->getIdentifiedSessions().insert( m_client_id, shared_from_this() ) );
+    if( ! is_registered )
     {
-        PRINT_ERR( "%s\n", e.what() );
+        ERROR_LOG( "Client '%s' is already connected.\n", m_client_id.c_str() );
         return Result::ID_FAILURE;
     }
+    StatsClock::duration took = StatsClock::now() - m_accepted_at;
+    m_metrics.m_identification_us.store( static_cast< ::std::uint64_t >( 
+        ::std::chrono::duration_cast< ::std::chrono::microseconds >( took ).count() ),
+        ::std::memory_order_relaxed );
+    m_parent_ptr->m_identification.add( took );
+    m_is_identified.store(true);
+    if( config.m_identified_cb )
+    {
+        config.m_identified_cb( m_handle, m_client_id );
+    }
+    DEBUG_LOG( GRN, "Client '%s' successfully identified.\n", m_client_id.c_str() );
+    return Result::ID_SUCCESS;
+}
+
+Result Server::Session::push( OutFrame&& frame )
+{
+    if( m_shm_uptr )
+    {
+        return m_shm_uptr->send( ::std::move( frame ), m_out_queue );
+    }
+    return m_out_queue.push( ::std::move( frame ) );
+}
+
+void Server::Session::notifySent( ::std::size_t bytes )
+{
+    Metrics::add( m_metrics.m_frames_out );
+    Metrics::add( m_metrics.m_bytes_out, bytes );
+    const Config& config = m_parent_ptr->getConfig();
+    if( config.m_send_handle_cb )
+    {
+        config.m_send_handle_cb( m_handle, bytes );
+        return;
+    }
+    config.m_send_cb( m_client_id, bytes );
+}
+
+void Server::Session::notifyError( const ErrorDescription& description )
+{
+    const Config& config = m_parent_ptr->getConfig();
+    if( config.m_error_handle_cb )
+    {
+        config.m_error_handle_cb( m_handle, description );
+        return;
+    }
+    config.m_error_cb( m_client_id, description );
+}
+
+ConnectionStats Server::Session::stats()
+{
+    ConnectionStats stats;
+    if( m_is_identified.load() ) /* Name is written before the flag */
+    {
+        stats.m_client_id = m_client_id;
+    }
+    m_metrics.fill( stats );
+    m_out_queue.depth( stats.m_queued_bytes, stats.m_queued_frames );
+    return stats;
 }
 
 Server::Session::~Session()
 {
     if( m_socket.is_open() )
     {
-        m_socket.shutdown( Socket::shutdown_both );
-        m_socket.close();
+        ErrCode ignored;
+        m_socket.shutdown( Socket::shutdown_both, ignored );
+        m_socket.close( ignored );
     }
-    PRINTF( YEL, "Session destroyed.\n");
+    m_parent_ptr->m_io_pool.release( m_io_index );
+    DEBUG_LOG( YEL, "Session destroyed.\n");
 }
 
 /* EOF */
\ No newline at end of file
@@ -0,0 +1,93 @@
+#ifndef UNIX_SOCKET_SHARDED_MAP_HPP
+#define UNIX_SOCKET_SHARDED_MAP_HPP
+
+#include "UnixSocket.h"
+
+namespace UnixSocket
+{
+
+template< typename Key, typename Value, ::std::size_t SHARDS >
+typename ShardedMap< Key, Value, SHARDS >::Shard& 
+    ShardedMap< Key, Value, SHARDS >::shardOf( const Key& key ) const
+{
+    /* 'std::hash' of pointers is identity, low bits are zero by alignment */
+    ::std::uint64_t hash = ::std::hash< Key >{}( key );
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return m_shards[ hash % SHARDS ];
+}
+
+template< typename Key, typename Value, ::std::size_t SHARDS >
+bool ShardedMap< Key, Value, SHARDS >::insert( const Key& key, const Value& value )
+{
+    Shard& shard = shardOf( key );
+    ::std::unique_lock< ::std::shared_mutex > lock( shard.m_mtx );
+    return shard.m_map.emplace( key, value ).second;
+}
+
+template< typename Key, typename Value, ::std::size_t SHARDS >
+Value ShardedMap< Key, Value, SHARDS >::find( const Key& key ) const
+{
+    Shard& shard = shardOf( key );
+    ::std::shared_lock< ::std::shared_mutex > lock( shard.m_mtx );
+    auto found = shard.m_map.find( key );
+    return ( found != shard.m_map.end() ) ? found->second : Value{};
+}
+
+template< typename Key, typename Value, ::std::size_t SHARDS >
+bool ShardedMap< Key, Value, SHARDS >::erase( const Key& key, const Value& value )
+{
+    Shard& shard = shardOf( key );
+    ::std::unique_lock< ::std::shared_mutex > lock( shard.m_mtx );
+    auto found = shard.m_map.find( key );
+    if( found == shard.m_map.end() || ! ( found->second == value ) )
+    {
+        return false;
+    }
+    shard.m_map.erase( found );
+    return true;
+}
+
+template< typename Key, typename Value, ::std::size_t SHARDS >
+template< typename Visitor >
+void ShardedMap< Key, Value, SHARDS >::forEach( Visitor&& visitor ) const
+{
+    for( Shard& shard : m_shards )
+    {
+        ::std::shared_lock< ::std::shared_mutex > lock( shard.m_mtx );
+        for( auto& it : shard.m_map )
+        {
+            visitor( it.first, it.second );
+        }
+    }
+}
+
+template< typename Key, typename Value, ::std::size_t SHARDS >
+void ShardedMap< Key, Value, SHARDS >::clear()
+{
+    for( Shard& shard : m_shards )
+    {
+        Map values;
+        {
+            ::std::unique_lock< ::std::shared_mutex > lock( shard.m_mtx );
+            values.swap( shard.m_map );
+        }
+    }
+}
+
+template< typename Key, typename Value, ::std::size_t SHARDS >
+::std::size_t ShardedMap< Key, Value, SHARDS >::size() const
+{
+    ::std::size_t total = 0;
+    for( Shard& shard : m_shards )
+    {
+        ::std::shared_lock< ::std::shared_mutex > lock( shard.m_mtx );
+        total += shard.m_map.size();
+    }
+    return total;
+}
+
+} //end namespace UnixSocket
+
+#endif /* UNIX_SOCKET_SHARDED_MAP_HPP */
\ No newline at end of file
@@ -0,0 +1,395 @@
+#include "UnixSocket.h"
+
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+using namespace UnixSocket;
+
+#define WRAP_MARKER     0xFFFFFFFF /* 'm_length' of the record : rest of the ring is skipped */
+#define MIN_RING_SIZE   4096
+
+/*---------------*/
+/*--- ShmRing ---*/
+/*---------------*/
+void ShmRing::attach( char * memory, ::std::size_t capacity, bool init )
+{
+    m_control = reinterpret_cast< Control * >( memory );
+    m_data = memory + sizeof( Control );
+    m_capacity = capacity;
+    if( init )
+    {
+        new ( m_control ) Control();
+        m_control->m_head.store( 0 );
+        m_control->m_tail.store( 0 );
+        m_control->m_consumer_sleeps.store( 1 );
+        m_control->m_producer_waits.store( 0 );
+    }
+}
+
+bool ShmRing::push( const OutFrame& frame )
+{
+    const FrameHeader& header = frame.m_header;
+    ::std::size_t size = record( header.m_length );
+    ::std::uint64_t head = m_control->m_head.load( ::std::memory_order_relaxed );
+    ::std::uint64_t tail = m_control->m_tail.load( ::std::memory_order_acquire );
+    ::std::size_t offset = head & ( m_capacity - 1 );
+    ::std::size_t to_end = m_capacity - offset;
+    ::std::size_t needed = size + ( to_end < size ? to_end : 0 );
+    if( m_capacity - ( head - tail ) < needed )
+    {
+        return false;
+    }
+    if( to_end < size ) /* Record should be contiguous */
+    {
+        FrameHeader marker{ WRAP_MARKER, 0, 0 };
+        ::std::memcpy( m_data + offset, & marker, sizeof( marker ) );
+        head += to_end;
+        offset = 0;
+    }
+    ::std::memcpy( m_data + offset, & header, sizeof( FrameHeader ) );
+    char * body = m_data + offset + sizeof( FrameHeader );
+    ::std::memcpy( body, frame.m_payload->data(), frame.m_payload->size() );
+    body += frame.m_payload->size();
+    for( const ConstBufferShPtr& chunk : frame.m_chunks )
+    {
+        ::std::memcpy( body, chunk->data(), chunk->size() );
+        body += chunk->size();
+    }
+    /* 'seq_cst' pairs with the check of 'm_consumer_sleeps' */
+    m_control->m_head.store( head + size );
+    return true;
+}
+
+bool ShmRing::peek( Frame& frame )
+{
+    ::std::uint64_t tail = m_control->m_tail.load( ::std::memory_order_relaxed );
+    ::std::uint64_t head = m_control->m_head.load();
+    while( head != tail )
+    {
+        ::std::size_t offset = tail & ( m_capacity - 1 );
+        FrameHeader header;
+        ::std::memcpy( & header, m_data + offset, sizeof( FrameHeader ) );
+        if( header.m_length == WRAP_MARKER )
+        {
+            tail += m_capacity - offset;
+            m_control->m_tail.store( tail, ::std::memory_order_release );
+            continue;
+        }
+        /* Memory is shared with other process, don't trust it */
+        ::std::size_t size = record( header.m_length );
+        if( header.m_length > m_capacity || size > m_capacity - offset || size > head - tail )
+        {
+            ERROR_LOG( "Shared memory ring is corrupted.\n" );
+            m_is_corrupted = true;
+            return false;
+        }
+        frame.m_header = header;
+        frame.m_data = m_data + offset + sizeof( FrameHeader );
+        frame.m_size = header.m_length;
+        frame.m_slab = nullptr;
+        m_peeked = size;
+        return true;
+    }
+    return false;
+}
+
+void ShmRing::pop()
+{
+    ::std::uint64_t tail = m_control->m_tail.load( ::std::memory_order_relaxed );
+    m_control->m_tail.store( tail + m_peeked, ::std::memory_order_release );
+    m_peeked = 0;
+}
+
+/*------------------*/
+/*--- ShmChannel ---*/
+/*------------------*/
+ShmChannel::ShmChannel( IoService& io_service,
+    FrameHandler frame_handler, DoneHandler done_handler, SentHandler sent_handler )
+    : m_frame_handler( ::std::move( frame_handler ) ),
+    m_done_handler( ::std::move( done_handler ) ),
+    m_sent_handler( ::std::move( sent_handler ) ),
+    m_wake( io_service )
+{ }
+
+Result ShmChannel::create( ::std::size_t& capacity, Fds& fds )
+{
+    if( isOpen() )
+    {
+        ERROR_LOG( "Shared memory is already created.\n" );
+        return Result::CFG_ERROR;
+    }
+    /* Power of two lets position be wrapped with mask */
+    ::std::size_t ring_size = MIN_RING_SIZE;
+    while( ring_size < capacity )
+    {
+        ring_size <<= 1;
+    }
+    capacity = ring_size;
+    m_memfd.reset( ::memfd_create( "UnixSocketShm", MFD_CLOEXEC ) );
+    Fd client_efd( ::eventfd( 0, EFD_CLOEXEC | EFD_NONBLOCK ) );
+    Fd server_efd( ::eventfd( 0, EFD_CLOEXEC | EFD_NONBLOCK ) );
+    if( m_memfd.get() < 0 || client_efd.get() < 0 || server_efd.get() < 0 ||
+        ::ftruncate( m_memfd.get(), 2 * ShmRing::footprint( ring_size ) ) != 0 )
+    {
+        ERROR_LOG( "Can't create shared memory : %s.\n", strerror( errno ) );
+        return Result::CFG_ERROR;
+    }
+    /* Copies go to the server */
+    if( dupFds( { m_memfd.get(), client_efd.get(), server_efd.get() }, fds ) != Result::ALL_GOOD )
+    {
+        return Result::CFG_ERROR;
+    }
+    m_peer_efd = ::std::move( server_efd );
+    m_wake.assign( client_efd.release() );
+    map( ring_size, true );
+    return isOpen() ? Result::ALL_GOOD : Result::CFG_ERROR;
+}
+
+Result ShmChannel::open( Fds& fds, ::std::size_t capacity )
+{
+    if( fds.size() != 3 || capacity < MIN_RING_SIZE || ( capacity & ( capacity - 1 ) ) != 0 )
+    {
+        ERROR_LOG( "Wrong shared memory offer.\n" );
+        return Result::CFG_ERROR;
+    }
+    m_memfd = ::std::move( fds[ 0 ] );
+    m_peer_efd = ::std::move( fds[ 1 ] );
+    m_wake.assign( fds[ 2 ].release() );
+    map( capacity, false );
+    return isOpen() ? Result::ALL_GOOD : Result::CFG_ERROR;
+}
+
+void ShmChannel::map( ::std::size_t capacity, bool is_client )
+{
+    ::std::size_t footprint = ShmRing::footprint( capacity );
+    void * memory = ::mmap( nullptr, 2 * footprint, PROT_READ | PROT_WRITE,
+        MAP_SHARED, m_memfd.get(), 0 );
+    if( memory == MAP_FAILED )
+    {
+        ERROR_LOG( "Can't map shared memory : %s.\n", strerror( errno ) );
+        return;
+    }
+    m_memory = static_cast< char * >( memory );
+    m_map_size = 2 * footprint;
+    /* First ring : client -> server, second : server -> client */
+    char * client_ring = m_memory;
+    char * server_ring = m_memory + footprint;
+    m_out.attach( is_client ? client_ring : server_ring, capacity, is_client );
+    m_in.attach( is_client ? server_ring : client_ring, capacity, is_client );
+    wait();
+}
+
+void ShmChannel::limit( ::std::size_t max_pending )
+{
+    ::std::lock_guard< ::std::mutex > lock( m_mtx );
+    m_max_pending = max_pending;
+}
+
+void ShmChannel::measure( Metrics& metrics )
+{
+    ::std::lock_guard< ::std::mutex > lock( m_mtx );
+    m_metrics_ptr = & metrics;
+}
+
+Result ShmChannel::send( OutFrame&& frame, OutQueue& out_queue )
+{
+    ::std::unique_lock< ::std::mutex > lock( m_mtx );
+    if( ! m_is_sending || ! frame.m_fds.empty() || ! m_out.fits( frame.size() ) )
+    {
+        return out_queue.push( ::std::move( frame ) ); /* Under the lock to keep the order */
+    }
+    if( m_pending.empty() && m_out.push( frame ) )
+    {
+        bool is_posted = addSent( sizeof( FrameHeader ) + frame.size() );
+        lock.unlock();
+        if( m_out.control().m_consumer_sleeps.exchange( 0 ) )
+        {
+            notify();
+        }
+        if( is_posted )
+        {
+            notifySent();
+        }
+        return Result::ALL_GOOD;
+    }
+    /* Ring is full, wait for the consumer */
+    if( m_max_pending != 0 && m_pending_bytes + frame.size() > m_max_pending )
+    {
+        if( m_metrics_ptr )
+        {
+            Metrics::add( m_metrics_ptr->m_overflows );
+        }
+        return Result::WOULD_BLOCK;
+    }
+    m_pending_bytes += frame.size();
+    m_pending.emplace_back( ::std::move( frame ) );
+    m_out.control().m_producer_waits.store( 1 );
+    lock.unlock();
+    flush(); /* Consumer could free the space before the flag was set */
+    return Result::ALL_GOOD;
+}
+
+void ShmChannel::attach( ::std::weak_ptr< void > owner )
+{
+    ::std::lock_guard< ::std::mutex > lock( m_mtx );
+    m_owner = ::std::move( owner );
+}
+
+void ShmChannel::startSending( OutFrame&& marker, OutQueue& out_queue )
+{
+    ::std::lock_guard< ::std::mutex > lock( m_mtx );
+    out_queue.push( ::std::move( marker ) );
+    m_is_sending = true;
+}
+
+void ShmChannel::startReceiving()
+{
+    m_is_receiving = true;
+    drain();
+}
+
+void ShmChannel::wait()
+{
+    m_wake.async_read_some( ::boost::asio::buffer( & m_wake_count, sizeof( m_wake_count ) ),
+        [ & ]( const ErrCode& error, ::std::size_t )
+        {
+            if( error == ::boost::asio::error::operation_aborted )
+            {
+                return; /* Channel is destroyed */
+            }
+            if( error )
+            {
+                ERROR_LOG( "Error when waiting for shared memory : %s\n", error.message().c_str() );
+                return;
+            }
+            flush();
+            drain();
+            this->wait();
+        } );
+}
+
+void ShmChannel::drain()
+{
+    if( ! m_is_receiving || m_in.isCorrupted() )
+    {
+        return;
+    }
+    Frame frame;
+    bool is_consumed = false;
+    while( true )
+    {
+        while( m_in.peek( frame ) )
+        {
+            m_frame_handler( frame );
+            m_in.pop();
+            is_consumed = true;
+        }
+        /* Announce sleep, then check again : producer could push in between */
+        m_in.control().m_consumer_sleeps.store( 1 );
+        if( m_in.isCorrupted() || ! m_in.peek( frame ) )
+        {
+            break;
+        }
+        m_in.control().m_consumer_sleeps.store( 0 );
+    }
+    if( is_consumed )
+    {
+        m_done_handler();
+        if( m_in.control().m_producer_waits.exchange( 0 ) )
+        {
+            notify();
+        }
+    }
+}
+
+void ShmChannel::flush()
+{
+    ::std::size_t sent = 0;
+    bool is_posted = false;
+    {
+        ::std::lock_guard< ::std::mutex > lock( m_mtx );
+        while( ! m_pending.empty() )
+        {
+            OutFrame& frame = m_pending.front();
+            if( ! m_out.push( frame ) )
+            {
+                m_out.control().m_producer_waits.store( 1 );
+                break;
+            }
+            is_posted = addSent( sizeof( FrameHeader ) + frame.size() ) || is_posted;
+            m_pending_bytes -= frame.size();
+            m_pending.pop_front();
+            sent++;
+        }
+    }
+    if( sent != 0 && m_out.control().m_consumer_sleeps.exchange( 0 ) )
+    {
+        notify();
+    }
+    if( is_posted )
+    {
+        notifySent();
+    }
+}
+
+bool ShmChannel::addSent( ::std::size_t bytes )
+{
+    m_sent.push_back( bytes );
+    bool is_posted = ! m_is_notifying;
+    m_is_notifying = true;
+    return is_posted;
+}
+
+void ShmChannel::notifySent()
+{
+    ::boost::asio::post( m_wake.get_executor(), [ this, keep = m_owner.lock() ]()
+        {
+            {
+                ::std::lock_guard< ::std::mutex > lock( m_mtx );
+                m_notified.swap( m_sent ); /* Both keep their capacity */
+                m_is_notifying = false;
+            }
+            for( ::std::size_t bytes : m_notified )
+            {
+                m_sent_handler( bytes );
+            }
+            m_notified.clear();
+        } );
+}
+
+void ShmChannel::notify()
+{
+    ::std::uint64_t one = 1;
+    if( ::write( m_peer_efd.get(), & one, sizeof( one ) ) < 0 && errno != EAGAIN )
+    {
+        ERROR_LOG( "Can't wake up the peer : %s.\n", strerror( errno ) );
+    }
+}
+
+void ShmChannel::close()
+{
+    {
+        ::std::lock_guard< ::std::mutex > lock( m_mtx );
+        m_is_sending = false;
+        m_pending.clear();
+        m_pending_bytes = 0;
+    }
+    m_is_receiving = false;
+    ErrCode ignored;
+    m_wake.close( ignored );
+}
+
+ShmChannel::~ShmChannel()
+{
+    if( m_wake.is_open() )
+    {
+        m_wake.close();
+    }
+    if( m_memory )
+    {
+        ::munmap( m_memory, m_map_size );
+    }
+}
+
+/* EOF */
\ No newline at end of file
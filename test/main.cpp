@@ -2,6 +2,13 @@
 #include <string>
 #include <thread>
 #include <chrono>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <random>
+#include <cstring>
+
+#include <unistd.h>
 
 #include <UnixSocket.h>
 
@@ -58,6 +65,596 @@ void clientErrorCallBack( const ::std::string& , const ::std::string& error)
 
 #define LOOP_DELAY  ::std::chrono::milliseconds(100)
 
+
+/*--------------*/
+/*--- Checks ---*/
+/*--------------*/
+static int failed_checks = 0;
+
+#define CHECK( condition ) \
+    do { \
+        if( ! ( condition ) ) \
+        { \
+            PRINTF( RED, "Check failed : %s ( %s:%d )\n", #condition, __FILE__, __LINE__ ); \
+            failed_checks++; \
+        } \
+    } while( 0 )
+
+/* Frames received by the server, in order */
+struct Received
+{
+    ::std::mutex m_mtx;
+    ::std::vector< ::std::string > m_frames;
+    int m_errors = 0;
+
+    void add( const ::std::string& data )
+    {
+        ::std::lock_guard< ::std::mutex > lock( m_mtx );
+        m_frames.push_back( data );
+    }
+    void error()
+    {
+        ::std::lock_guard< ::std::mutex > lock( m_mtx );
+        m_errors++;
+    }
+    ::std::size_t count()
+    {
+        ::std::lock_guard< ::std::mutex > lock( m_mtx );
+        return m_frames.size();
+    }
+    void waitFor( ::std::size_t frames )
+    {
+        for( int i = 0; i < 100 && count() < frames; i++ )
+        {
+            ::std::this_thread::sleep_for( ::std::chrono::milliseconds( 10 ) );
+        }
+    }
+}; //end struct Received
+
+/* Wire bytes go to the buffer in reads of random sizes, complete frames are taken after each */
+void feed( ::UnixSocket::InBuffer& in_buf, ::UnixSocket::Framing framing, const ::std::string& end_tag,
+    const ::std::string& wire, ::std::mt19937& random, ::std::size_t max_read,
+    ::std::vector< ::UnixSocket::Retained >& frames )
+{
+    ::std::size_t pos = 0;
+    while( pos < wire.size() )
+    {
+        ::std::size_t read = ::std::uniform_int_distribution< ::std::size_t >( 1, max_read )( random );
+        ::boost::asio::mutable_buffer space = in_buf.prepare( read );
+        read = ::std::min( { read, space.size(), wire.size() - pos } );
+        ::std::memcpy( space.data(), wire.data() + pos, read );
+        in_buf.commit( read );
+        pos += read;
+        ::UnixSocket::Frame frame;
+        while( in_buf.next( framing, end_tag, frame ) )
+        { /* Retained ones keep the slab, so the buffer moves on to the new one */
+            frames.push_back( frame.retain() );
+        }
+    }
+}
+
+/* Messages of the lanes are split into pieces of random sizes and interleaved on the wire */
+void checkReassembly()
+{
+    ::std::mt19937 random( 2024 );
+    for( int round = 0; round < 50; round++ )
+    {
+        ::std::vector< ::std::string > sent;
+        ::std::vector< ::std::vector< ::std::string > > pieces( ::UnixSocket::PRIORITY_LANES );
+        for( ::std::size_t lane = 0; lane < ::UnixSocket::PRIORITY_LANES; lane++ )
+        {
+            int messages = ::std::uniform_int_distribution< int >( 0, 20 )( random );
+            for( int idx = 0; idx < messages; idx++ )
+            {
+                ::std::string message = ::std::to_string( lane ) + ":" + ::std::to_string( idx ) + ":";
+                ::std::size_t prefix = message.size();
+                message.resize( prefix + 
+                    ::std::uniform_int_distribution< ::std::size_t >( 0, 5000 )( random ) );
+                for( ::std::size_t byte = prefix; byte < message.size(); byte++ )
+                {
+                    message[ byte ] = static_cast< char >( random() );
+                }
+                sent.push_back( message );
+                ::std::size_t offset = 0;
+                do
+                {
+                    ::std::size_t length = ::std::min( message.size() - offset, 
+                        ::std::uniform_int_distribution< ::std::size_t >( 1, 2048 )( random ) );
+                    bool is_whole = ( offset == 0 && length == message.size() );
+                    ::UnixSocket::FrameHeader header = ::UnixSocket::makeHeader( length );
+                    if( ! is_whole )
+                    {
+                        header.m_flags = ::UnixSocket::FLAG_CHUNK | ( lane << 8 );
+                        header.m_flags |= ( offset + length < message.size() ) ? 
+                            ::UnixSocket::FLAG_MORE : 0;
+                    }
+                    ::std::string piece( reinterpret_cast< const char * >( & header ), sizeof( header ) );
+                    piece.append( message, offset, length );
+                    pieces[ lane ].push_back( ::std::move( piece ) );
+                    offset += length;
+                } while( offset < message.size() );
+            }
+        }
+        /* Each lane keeps its own order */
+        ::std::string wire;
+        ::std::vector< ::std::size_t > next( ::UnixSocket::PRIORITY_LANES, 0 );
+        for( ;; )
+        {
+            ::std::vector< ::std::size_t > ready;
+            for( ::std::size_t lane = 0; lane < ::UnixSocket::PRIORITY_LANES; lane++ )
+            {
+                if( next[ lane ] < pieces[ lane ].size() )
+                {
+                    ready.push_back( lane );
+                }
+            }
+            if( ready.empty() )
+            {
+                break;
+            }
+            ::std::size_t lane = ready[ random() % ready.size() ];
+            wire += pieces[ lane ][ next[ lane ]++ ];
+        }
+
+        ::UnixSocket::InBuffer in_buf;
+        ::std::vector< ::UnixSocket::Retained > frames;
+        feed( in_buf, ::UnixSocket::Framing::LENGTH_PREFIX, "", wire, random, 3000, frames );
+        CHECK( frames.size() == sent.size() );
+        ::std::vector< int > expected( ::UnixSocket::PRIORITY_LANES, 0 );
+        bool is_intact = true;
+        for( const ::UnixSocket::Retained& frame : frames )
+        {
+            ::std::size_t lane = static_cast< ::std::size_t >( frame.data()[ 0 ] - '0' );
+            if( lane >= ::UnixSocket::PRIORITY_LANES )
+            {
+                is_intact = false;
+                break;
+            }
+            ::std::string prefix = ::std::to_string( lane ) + ":" + ::std::to_string( expected[ lane ]++ ) + ":";
+            is_intact = is_intact && frame.view().substr( 0, prefix.size() ) == prefix &&
+                ::std::find( sent.begin(), sent.end(), frame.view() ) != sent.end();
+        }
+        CHECK( is_intact );
+    }
+}
+
+/* Big frames of two lanes are written in pieces at once, small ones go between them */
+void checkLaneChunks()
+{
+    const char * address = "/tmp/UnixSocketChunkTest";
+    const int frames = 20;
+    Received received;
+    ::UnixSocket::Server server;
+    ::UnixSocket::Server::Config config =
+    {
+        .m_recv_cb      = [ & ]( const ::std::string& , ::std::string& data ){ received.add( data ); },
+        .m_send_cb      = []( const ::std::string& , ::std::size_t ){},
+        .m_error_cb     = [ & ]( const ::std::string& , const ::std::string& ){ received.error(); },
+        .m_address      = address,
+        .m_delimiter    = "body",
+        .m_id_key       = "auth",
+        .m_framing      = ::UnixSocket::Framing::LENGTH_PREFIX
+    };
+    config.m_handshake = ::UnixSocket::Handshake::BINARY;
+    server.setConfig( ::std::move( config ) );
+    server.start();
+
+    ::UnixSocket::Client client;
+    ::UnixSocket::Client::Config client_config =
+    {
+        .m_recv_cb      = []( const ::std::string& , ::std::string& ){},
+        .m_send_cb      = []( const ::std::string& , ::std::size_t ){},
+        .m_error_cb     = []( const ::std::string& , const ::std::string& ){},
+        .m_address      = address,
+        .m_delimiter    = "body",
+        .m_id_key       = "auth",
+        .m_client_id    = "chunkClient",
+        .m_con_type     = ::UnixSocket::Client::ConnectType::SYNC_CONNECT,
+        .m_framing      = ::UnixSocket::Framing::LENGTH_PREFIX
+    };
+    client_config.m_handshake = ::UnixSocket::Handshake::BINARY;
+    client_config.m_chunk_size = 4096;
+    client.setConfig( ::std::move( client_config ) );
+    client.start();
+    auto message = []( char lane, int idx, ::std::size_t size )
+    {
+        ::std::string data = lane + ::std::to_string( idx ) + ":";
+        data.resize( size, static_cast< char >( 'a' + idx ) );
+        return data;
+    };
+    for( int idx = 0; idx < frames; idx++ )
+    {
+        client.send( ::UnixSocket::Priority::BULK, message( 'b', idx, 300 * 1024 ) );
+        client.send( ::UnixSocket::Priority::HIGH, message( 'h', idx, 100 * 1024 ) );
+        client.send( ::UnixSocket::Priority::NORMAL, message( 'n', idx, 100 ) );
+    }
+
+    received.waitFor( 3 * frames );
+    CHECK( received.count() == 3 * frames );
+    CHECK( received.m_errors == 0 );
+    int high = 0, normal = 0, bulk = 0;
+    bool is_intact = true;
+    for( const ::std::string& data : received.m_frames )
+    {
+        int& idx = ( data[ 0 ] == 'h' ) ? high : ( data[ 0 ] == 'n' ) ? normal : bulk;
+        ::std::size_t size = ( data[ 0 ] == 'h' ) ? 100 * 1024 : ( data[ 0 ] == 'n' ) ? 100 : 300 * 1024;
+        is_intact = is_intact && data == message( data[ 0 ], idx++, size );
+    }
+    CHECK( is_intact );
+    ::unlink( address );
+}
+
+/* Client rejected at each identification stops after 'm_max_attempts' */
+void checkRejectedGivesUp()
+{
+    const char * address = "/tmp/UnixSocketRejectTest";
+    ::UnixSocket::Server server;
+    ::UnixSocket::Server::Config config =
+    {
+        .m_recv_cb      = []( const ::std::string& , ::std::string& ){},
+        .m_send_cb      = []( const ::std::string& , ::std::size_t ){},
+        .m_error_cb     = []( const ::std::string& , const ::std::string& ){},
+        .m_address      = address,
+        .m_delimiter    = "body",
+        .m_id_key       = "auth",
+        .m_framing      = ::UnixSocket::Framing::LENGTH_PREFIX
+    };
+    config.m_handshake = ::UnixSocket::Handshake::BINARY;
+    server.setConfig( ::std::move( config ) );
+    server.start();
+
+    Received errors;
+    ::UnixSocket::Client client;
+    ::UnixSocket::Client::Config client_config =
+    {
+        .m_recv_cb      = []( const ::std::string& , ::std::string& ){},
+        .m_send_cb      = []( const ::std::string& , ::std::size_t ){},
+        .m_error_cb     = [ & ]( const ::std::string& , const ::std::string& error ){ errors.add( error ); },
+        .m_address      = address,
+        .m_delimiter    = "body",
+        .m_id_key       = "auth",
+        .m_client_id    = "rejectedClient", /* XML one is rejected by the binary server */
+        .m_con_type     = ::UnixSocket::Client::ConnectType::ASYNC_CONNECT,
+        .m_framing      = ::UnixSocket::Framing::LENGTH_PREFIX
+    };
+    client_config.m_backoff.m_min_delay = ::std::chrono::milliseconds( 5 );
+    client_config.m_backoff.m_max_delay = ::std::chrono::milliseconds( 100 );
+    client_config.m_backoff.m_max_attempts = 3;
+    client.setConfig( ::std::move( client_config ) );
+    client.start();
+
+    ::std::this_thread::sleep_for( ::std::chrono::milliseconds( 600 ) );
+    CHECK( client.stats().m_connects == 4 ); /* First one and three attempts */
+    CHECK( errors.count() != 0 && errors.m_frames.back() == "Server isn't reachable" );
+    ::unlink( address );
+}
+
+/* Send callback sends again, while frames wait for space in the ring */
+void checkShmResend()
+{
+    const char * address = "/tmp/UnixSocketResendTest";
+    const ::std::size_t frames = 2000;
+    Received received;
+    ::UnixSocket::Server server;
+    ::UnixSocket::Server::Config config =
+    {
+        .m_recv_cb      = [ & ]( const ::std::string& , ::std::string& data ){ received.add( data ); },
+        .m_send_cb      = []( const ::std::string& , ::std::size_t ){},
+        .m_error_cb     = []( const ::std::string& , const ::std::string& ){},
+        .m_address      = address,
+        .m_delimiter    = "body",
+        .m_id_key       = "auth",
+        .m_framing      = ::UnixSocket::Framing::LENGTH_PREFIX
+    };
+    config.m_pass_fds = true;
+    config.m_allow_shm = true;
+    config.m_handshake = ::UnixSocket::Handshake::BINARY;
+    server.setConfig( ::std::move( config ) );
+    server.start();
+
+    ::UnixSocket::Client client;
+    ::std::atomic< ::std::size_t > sent{ 0 };
+    const ::std::string data( 8192, 'r' );
+    ::UnixSocket::Client::Config client_config =
+    {
+        .m_recv_cb      = []( const ::std::string& , ::std::string& ){},
+        .m_send_cb      = [ & ]( const ::std::string& , ::std::size_t )
+            {
+                if( sent.fetch_add( 1 ) < frames )
+                {
+                    client.send( ::std::string( data ) );
+                }
+            },
+        .m_error_cb     = []( const ::std::string& , const ::std::string& ){},
+        .m_address      = address,
+        .m_delimiter    = "body",
+        .m_id_key       = "auth",
+        .m_client_id    = "resendClient",
+        .m_con_type     = ::UnixSocket::Client::ConnectType::SYNC_CONNECT,
+        .m_framing      = ::UnixSocket::Framing::LENGTH_PREFIX
+    };
+    client_config.m_pass_fds = true;
+    client_config.m_shm_size = 64 * 1024; /* Fills up at once */
+    client_config.m_handshake = ::UnixSocket::Handshake::BINARY;
+    client.setConfig( ::std::move( client_config ) );
+    client.start();
+    ::std::this_thread::sleep_for( ::std::chrono::milliseconds( 50 ) ); /* Shared memory is started */
+    sent = 0;
+    for( int i = 0; i < 32; i++ )
+    {
+        client.send( ::std::string( data ) );
+    }
+
+    for( int i = 0; i < 100 && sent.load() < frames; i++ )
+    {
+        ::std::this_thread::sleep_for( ::std::chrono::milliseconds( 10 ) );
+    }
+    CHECK( sent.load() >= frames );
+    ::unlink( address );
+}
+
+/* Call times out while its request waits for the room in the queue, then send fails */
+void checkRpcTimeoutDuringSend()
+{
+    const char * address = "/tmp/UnixSocketRpcTest";
+    ::UnixSocket::RpcServer server;
+    ::UnixSocket::RpcServer::Config config;
+    config.m_server.m_address = address;
+    config.m_server.m_framing = ::UnixSocket::Framing::LENGTH_PREFIX;
+    config.m_server.m_handshake = ::UnixSocket::Handshake::BINARY;
+    config.m_request_cb = []( ::UnixSocket::ClientHandle , ::std::string& , 
+        const ::UnixSocket::RpcServer::Reply& )
+        { /* Socket fills up meanwhile */
+            ::std::this_thread::sleep_for( ::std::chrono::milliseconds( 300 ) );
+        };
+    server.setConfig( ::std::move( config ) );
+    server.start();
+
+    ::UnixSocket::RpcClient client;
+    ::UnixSocket::RpcClient::Config client_config;
+    client_config.m_client.m_address = address;
+    client_config.m_client.m_client_id = "rpcClient";
+    client_config.m_client.m_con_type = ::UnixSocket::Client::ConnectType::SYNC_CONNECT;
+    client_config.m_client.m_framing = ::UnixSocket::Framing::LENGTH_PREFIX;
+    client_config.m_client.m_handshake = ::UnixSocket::Handshake::BINARY;
+    client_config.m_client.m_watermarks.m_high_frames = 1;
+    client_config.m_client.m_watermarks.m_overflow = ::UnixSocket::Overflow::BLOCK;
+    client_config.m_client.m_watermarks.m_block_timeout = ::std::chrono::milliseconds( 200 );
+    client_config.m_timeout = ::std::chrono::milliseconds( 20 );
+    client.setConfig( ::std::move( client_config ) );
+    client.start();
+
+    const ::std::string request( 8 << 20, 'q' );
+    ::std::vector< ::std::future< ::std::string > > replies;
+    bool is_thrown = false;
+    try
+    {
+        for( int i = 0; i < 3; i++ )
+        {
+            replies.push_back( client.call( request ) );
+        }
+    } catch( const ::std::exception& )
+    { /* Promise is satisfied twice */
+        is_thrown = true;
+    }
+    CHECK( ! is_thrown );
+    int timed_out = 0;
+    for( ::std::future< ::std::string >& reply : replies )
+    {
+        try
+        {
+            reply.get();
+        } catch( const ::std::runtime_error& )
+        {
+            timed_out++;
+        }
+    }
+    CHECK( timed_out == 3 );
+    ::unlink( address );
+}
+
+/* Blocked senders never overfill the queue, multicast reports clients, that didn't take data */
+void checkOverflow( ::UnixSocket::Overflow overflow )
+{
+    const char * address = "/tmp/UnixSocketOverflowTest";
+    ::UnixSocket::Server server;
+    ::UnixSocket::Server::Config config =
+    {
+        .m_recv_cb      = []( const ::std::string& , ::std::string& ){},
+        .m_send_cb      = []( const ::std::string& , ::std::size_t ){},
+        .m_error_cb     = []( const ::std::string& , const ::std::string& ){},
+        .m_address      = address,
+        .m_delimiter    = "body",
+        .m_id_key       = "auth",
+        .m_framing      = ::UnixSocket::Framing::LENGTH_PREFIX
+    };
+    config.m_handshake = ::UnixSocket::Handshake::BINARY;
+    config.m_watermarks.m_high_frames = 2;
+    config.m_watermarks.m_overflow = overflow;
+    config.m_watermarks.m_block_timeout = ::std::chrono::milliseconds( 2000 );
+    server.setConfig( ::std::move( config ) );
+    server.start();
+
+    Received received;
+    ::UnixSocket::Client client;
+    ::UnixSocket::Client::Config client_config =
+    {
+        .m_recv_cb      = [ & ]( const ::std::string& , ::std::string& data ){ received.add( data ); },
+        .m_send_cb      = []( const ::std::string& , ::std::size_t ){},
+        .m_error_cb     = []( const ::std::string& , const ::std::string& ){},
+        .m_address      = address,
+        .m_delimiter    = "body",
+        .m_id_key       = "auth",
+        .m_client_id    = "overflowClient",
+        .m_con_type     = ::UnixSocket::Client::ConnectType::SYNC_CONNECT,
+        .m_framing      = ::UnixSocket::Framing::LENGTH_PREFIX
+    };
+    client_config.m_handshake = ::UnixSocket::Handshake::BINARY;
+    client.setConfig( ::std::move( client_config ) );
+    client.start();
+    ::std::this_thread::sleep_for( ::std::chrono::milliseconds( 50 ) ); /* Identified */
+
+    const ::std::string data( 4 << 20, 'm' );
+    const int senders = 4;
+    const int frames = 4;
+    ::std::atomic< int > blocked{ 0 };
+    ::std::atomic< bool > is_done{ false };
+    ::std::size_t max_queued = 0;
+    ::std::thread watcher( [ & ]()
+        {
+            while( ! is_done.load() )
+            {
+                ::UnixSocket::Server::Stats stats = server.stats();
+                for( const ::UnixSocket::ConnectionStats& session : stats.m_sessions )
+                {
+                    max_queued = ::std::max( max_queued, session.m_queued_frames );
+                }
+            }
+        } );
+    ::std::vector< ::std::thread > threads;
+    for( int i = 0; i < senders; i++ )
+    {
+        threads.emplace_back( [ & ]()
+            {
+                for( int frame = 0; frame < frames; frame++ )
+                {
+                    blocked += ( server.multiCast( data ) == ::UnixSocket::Result::WOULD_BLOCK ) ? 1 : 0;
+                }
+            } );
+    }
+    for( ::std::thread& thread : threads )
+    {
+        thread.join();
+    }
+    is_done = true;
+    watcher.join();
+    if( overflow == ::UnixSocket::Overflow::BLOCK )
+    {
+        CHECK( max_queued <= 2 );
+        CHECK( blocked.load() == 0 );
+        received.waitFor( senders * frames );
+        CHECK( received.count() == senders * frames );
+    }
+    else
+    {
+        CHECK( blocked.load() != 0 );
+    }
+    ::unlink( address );
+}
+
+/* Frames sent before the connection, of any lane, go after the identification */
+void checkIdentificationOrder( ::UnixSocket::Handshake handshake, ::UnixSocket::Framing framing )
+{
+    const char * address = "/tmp/UnixSocketOrderTest";
+    Received received;
+    ::UnixSocket::Server server;
+    ::UnixSocket::Server::Config config =
+    {
+        .m_recv_cb      = [ & ]( const ::std::string& , ::std::string& data ){ received.add( data ); },
+        .m_send_cb      = []( const ::std::string& , ::std::size_t ){},
+        .m_error_cb     = [ & ]( const ::std::string& , const ::std::string& ){ received.error(); },
+        .m_address      = address,
+        .m_delimiter    = "body",
+        .m_id_key       = "auth",
+        .m_framing      = framing
+    };
+    config.m_handshake = handshake;
+    server.setConfig( ::std::move( config ) );
+    server.start();
+
+    ::UnixSocket::Client client;
+    ::UnixSocket::Client::Config client_config =
+    {
+        .m_recv_cb      = []( const ::std::string& , ::std::string& ){},
+        .m_send_cb      = []( const ::std::string& , ::std::size_t ){},
+        .m_error_cb     = []( const ::std::string& , const ::std::string& ){},
+        .m_address      = address,
+        .m_delimiter    = "body",
+        .m_id_key       = "auth",
+        .m_client_id    = "orderClient",
+        .m_con_type     = ::UnixSocket::Client::ConnectType::ASYNC_CONNECT,
+        .m_framing      = framing
+    };
+    client_config.m_handshake = handshake;
+    client_config.m_offline_bytes = 1024;
+    client.setConfig( ::std::move( client_config ) );
+    /* Queued offline, flushed right behind the identification */
+    client.send( ::UnixSocket::Priority::BULK, ::std::string{ "<body>bulk</body>" } );
+    client.send( ::UnixSocket::Priority::HIGH, ::std::string{ "<body>urgent</body>" } );
+    client.start();
+    client.send( ::UnixSocket::Priority::HIGH, ::std::string{ "<body>online</body>" } );
+
+    received.waitFor( 3 );
+    CHECK( received.count() == 3 );
+    CHECK( received.m_errors == 0 );
+    CHECK( server.stats().m_rejected == 0 );
+    ::unlink( address );
+}
+
+/* Frames queued before the shared memory is started go through the socket ahead of the marker */
+void checkShmOrder()
+{
+    const char * address = "/tmp/UnixSocketShmTest";
+    const ::std::size_t frames = 2000;
+    Received received;
+    ::UnixSocket::Server server;
+    ::UnixSocket::Server::Config config =
+    {
+        .m_recv_cb      = [ & ]( const ::std::string& , ::std::string& data ){ received.add( data ); },
+        .m_send_cb      = []( const ::std::string& , ::std::size_t ){},
+        .m_error_cb     = [ & ]( const ::std::string& , const ::std::string& ){ received.error(); },
+        .m_address      = address,
+        .m_delimiter    = "body",
+        .m_id_key       = "auth",
+        .m_framing      = ::UnixSocket::Framing::LENGTH_PREFIX
+    };
+    config.m_pass_fds = true;
+    config.m_allow_shm = true;
+    config.m_handshake = ::UnixSocket::Handshake::BINARY;
+    config.m_chunk_size = 64 * 1024;
+    server.setConfig( ::std::move( config ) );
+    server.start();
+
+    ::UnixSocket::Client client;
+    ::UnixSocket::Client::Config client_config =
+    {
+        .m_recv_cb      = []( const ::std::string& , ::std::string& ){},
+        .m_send_cb      = []( const ::std::string& , ::std::size_t ){},
+        .m_error_cb     = []( const ::std::string& , const ::std::string& ){},
+        .m_address      = address,
+        .m_delimiter    = "body",
+        .m_id_key       = "auth",
+        .m_client_id    = "shmClient",
+        .m_con_type     = ::UnixSocket::Client::ConnectType::ASYNC_CONNECT,
+        .m_framing      = ::UnixSocket::Framing::LENGTH_PREFIX
+    };
+    client_config.m_pass_fds = true;
+    client_config.m_shm_size = 1 << 20;
+    client_config.m_handshake = ::UnixSocket::Handshake::BINARY;
+    client_config.m_offline_bytes = 64 << 20;
+    client_config.m_chunk_size = 64 * 1024; /* Writes are batched by it */
+    client.setConfig( ::std::move( client_config ) );
+    for( ::std::size_t i = 0; i < frames; i++ )
+    {
+        if( i == frames / 2 )
+        { /* Offline half is still queued, when the server accepts the offer */
+            client.start();
+            ::std::this_thread::sleep_for( ::std::chrono::milliseconds( 5 ) );
+        }
+        client.send( ::UnixSocket::Priority::BULK, ::std::to_string( i ) + ::std::string( 8192, ' ' ) );
+    }
+
+    received.waitFor( frames );
+    CHECK( received.count() == frames );
+    bool is_ordered = true;
+    for( ::std::size_t i = 0; i < received.m_frames.size(); i++ )
+    {
+        is_ordered = is_ordered && received.m_frames[ i ].find( ::std::to_string( i ) + ' ' ) == 0;
+    }
+    CHECK( is_ordered );
+    ::unlink( address );
+}
+
 int main( int , char** )
 {
 
@@ -141,6 +738,19 @@ int main( int , char** )
     ::std::this_thread::sleep_for( LOOP_DELAY );
 #endif
 
+    checkIdentificationOrder( ::UnixSocket::Handshake::BINARY, ::UnixSocket::Framing::LENGTH_PREFIX );
+    checkIdentificationOrder( ::UnixSocket::Handshake::XML, ::UnixSocket::Framing::LENGTH_PREFIX );
+    checkIdentificationOrder( ::UnixSocket::Handshake::XML, ::UnixSocket::Framing::DELIMITER );
+    checkShmOrder();
+    checkReassembly();
+    checkLaneChunks();
+    checkRejectedGivesUp();
+    checkShmResend();
+    checkRpcTimeoutDuringSend();
+    checkOverflow( ::UnixSocket::Overflow::BLOCK );
+    checkOverflow( ::UnixSocket::Overflow::DROP_NEWEST );
+    PRINTF( failed_checks ? RED : GRN, "Failed checks : %d.\n", failed_checks );
+
     PRINTF( RED , "Exit main.\n" );
-    return 0;
+    return ( failed_checks == 0 ) ? 0 : 1;
 }
\ No newline at end of file